@@ -29,7 +29,7 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := modloader-utils
 LOCAL_SRC_FILES += $(call rwildcard,src/,*.cpp)
 LOCAL_SHARED_LIBRARIES += modloader
-LOCAL_LDLIBS += -llog
+LOCAL_LDLIBS += -llog -lz
 LOCAL_CFLAGS += -I'extern/libil2cpp/il2cpp/libil2cpp' -DID='"modloader-utils"' -DVERSION='"1.0.2"' -I'./shared' -I'./extern' -isystem'extern/codegen/include'
 LOCAL_CPPFLAGS += -std=c++2a
 LOCAL_C_INCLUDES += ./include ./src
@@ -0,0 +1,412 @@
+#include "modloader-utils/shared/WebUtils.hpp"
+#include "modloader-utils/shared/HttpCache.hpp"
+#include "modloader-utils/shared/HashUtils.hpp"
+#include "modloader-utils/shared/Types/QMod.hpp"
+
+#include "LoopbackServer.hpp"
+#include "SyntheticQMod.hpp"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace ModloaderUtils;
+
+namespace Bench {
+	// How long each operation took, in milliseconds, and how much it moved
+	struct Measurement {
+		std::vector<double> latencies;
+		uint64_t bytes = 0;
+		double seconds = 0;
+		uint64_t peakRss = 0;
+		ServerStats server;
+		bool ok = true;
+	};
+
+	struct Options {
+		// Smaller files and fewer runs, so the whole suite finishes in a few seconds
+		bool quick = false;
+
+		// Installing writes to /sdcard, the same as it does on the Quest, so it has to be asked for
+		bool install = false;
+	};
+
+	inline const std::string Host = "qmods.bench";
+
+	inline std::string TempPath;
+	inline std::unique_ptr<LoopbackServer> Server;
+	inline int Failures = 0;
+
+	std::string Url(std::string path) {
+		return "http://" + Host + path;
+	}
+
+	std::string SHA256Of(const std::string& data) {
+		HashUtils::SHA256 sha256;
+		sha256.Update(data.data(), data.size());
+		return sha256.HexDigest();
+	}
+
+	// Resets the kernel's high water mark, so the next ReadPeakRss only covers what happens after this
+	void ResetPeakRss() {
+		std::ofstream clearRefs("/proc/self/clear_refs");
+		clearRefs << "5";
+	}
+
+	uint64_t ReadPeakRss() {
+		std::ifstream status("/proc/self/status");
+		std::string line;
+
+		while (std::getline(status, line)) {
+			if (line.starts_with("VmHWM:")) return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+		}
+
+		return 0;
+	}
+
+	double Percentile(std::vector<double> values, double percentile) {
+		if (values.empty()) return 0;
+
+		std::sort(values.begin(), values.end());
+		size_t rank = (size_t)(percentile / 100 * (values.size() - 1) + 0.5);
+
+		return values[std::min(rank, values.size() - 1)];
+	}
+
+	void Report(std::string name, const Measurement& measurement) {
+		double mebibytes = measurement.bytes / (1024.0 * 1024.0);
+		double throughput = measurement.seconds > 0 ? mebibytes / measurement.seconds : 0;
+
+		printf("%-52s %4zu ops %9.1f MiB/s   p50 %8.2fms  p90 %8.2fms  p99 %8.2fms   peak RSS %6.1f MiB   %4llu requests%s\n",
+			name.c_str(), measurement.latencies.size(), throughput,
+			Percentile(measurement.latencies, 50), Percentile(measurement.latencies, 90), Percentile(measurement.latencies, 99),
+			measurement.peakRss / (1024.0 * 1024.0), (unsigned long long)measurement.server.requests, measurement.ok ? "" : " FAILED");
+
+		if (!measurement.ok) Failures++;
+	}
+
+	// Runs count operations, concurrency at a time. Each operation returns how many bytes it moved, or nullopt if it failed
+	Measurement Measure(size_t count, size_t concurrency, const std::function<std::optional<uint64_t>(size_t index)>& operation) {
+		Measurement measurement;
+		measurement.latencies.resize(count);
+
+		Server->ResetStats();
+		ResetPeakRss();
+
+		std::atomic<size_t> next = 0;
+		std::atomic<uint64_t> bytes = 0;
+		std::atomic<bool> ok = true;
+
+		auto Worker = [&] {
+			for (size_t index = next++; index < count; index = next++) {
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				std::optional<uint64_t> moved = operation(index);
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+				measurement.latencies[index] = elapsed.count();
+
+				if (moved.has_value()) bytes += *moved;
+				else ok = false;
+			}
+		};
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < std::max<size_t>(concurrency, 1); i++) workers.emplace_back(Worker);
+		for (std::thread& worker : workers) worker.join();
+
+		measurement.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		measurement.bytes = bytes;
+		measurement.peakRss = ReadPeakRss();
+		measurement.server = Server->GetStats();
+		measurement.ok = ok;
+
+		return measurement;
+	}
+
+	// Downloads a file and checks it came out right. Every run gets its own url, so nothing is served from the cache
+	std::optional<uint64_t> DownloadAndCheck(std::string path, std::string run, const std::string& expectedSHA256, uint64_t sizeHint) {
+		std::string destination = TempPath + "downloads/" + run;
+		DownloadResult result = WebUtils::DownloadFile(run, Url(path + "?run=" + run), destination, RequestPriority::Normal, "", nullptr, sizeHint);
+
+		bool matches = result && result.sha256 == expectedSHA256;
+		unlink(destination.c_str());
+
+		if (!matches) return std::nullopt;
+		return result.size;
+	}
+
+	void BenchDownloads(std::string name, uint64_t size, ServedFile served, size_t count, size_t concurrency, bool hintSize) {
+		std::string path = "/" + name + ".bin";
+
+		served.body = MakeSyntheticData(size, count);
+		served.etag = "\"" + name + "\"";
+
+		std::string expectedSHA256 = SHA256Of(served.body);
+		Server->Serve(path, std::move(served));
+
+		static int runs = 0;
+		int run = runs++;
+
+		Measurement measurement = Measure(count, concurrency, [&](size_t index) {
+			return DownloadAndCheck(path, name + "-" + std::to_string(run) + "-" + std::to_string(index), expectedSHA256, hintSize ? size : 0);
+		});
+
+		Server->Unserve(path);
+		Report("DownloadFile " + name, measurement);
+	}
+
+	// A download that gets cut off half way, then carries on from where it stopped
+	void BenchResume(std::string name, uint64_t size, size_t count) {
+		std::string path = "/" + name + ".bin";
+
+		ServedFile served;
+		served.body = MakeSyntheticData(size, 7);
+		served.etag = "\"" + name + "\"";
+		served.dropCount = count;
+		served.dropAfter = size / 2;
+
+		std::string expectedSHA256 = SHA256Of(served.body);
+		Server->Serve(path, std::move(served));
+
+		// Checkpoint often enough that the resume carries on from close to where the drop happened
+		uint64_t checkpointInterval = WebUtils::DownloadCheckpointInterval;
+		WebUtils::DownloadCheckpointInterval = 256 * 1024;
+
+		Measurement measurement = Measure(count, 1, [&](size_t index) -> std::optional<uint64_t> {
+			std::string run = name + "-" + std::to_string(index);
+
+			// The first attempt is expected to fail, and leave a partial download behind for the second
+			if (WebUtils::DownloadFile(run, Url(path + "?run=" + run), TempPath + "downloads/" + run)) return std::nullopt;
+			return DownloadAndCheck(path, run, expectedSHA256, 0);
+		});
+
+		WebUtils::DownloadCheckpointInterval = checkpointInterval;
+		Server->Unserve(path);
+		Report("DownloadFile " + name, measurement);
+
+		// Resuming should only send the second half again, not the whole file
+		double overhead = (double)measurement.server.bodyBytes / (size * count);
+		printf("%-52s %.2fx the file size sent by the server\n", "", overhead);
+	}
+
+	// The same url again and again, so after the first request its only ever revalidated
+	void BenchRevalidation(std::string name, uint64_t size, size_t count) {
+		std::string path = "/" + name + ".bin";
+
+		ServedFile served;
+		served.body = MakeSyntheticData(size, 11);
+		served.etag = "\"" + name + "\"";
+
+		std::string expectedSHA256 = SHA256Of(served.body);
+		Server->Serve(path, std::move(served));
+
+		int64_t revalidateInterval = HttpCache::RevalidateInterval;
+		HttpCache::RevalidateInterval = 0;
+
+		Measurement measurement = Measure(count, 1, [&](size_t index) -> std::optional<uint64_t> {
+			std::string destination = TempPath + "downloads/" + name;
+			DownloadResult result = WebUtils::DownloadFile(name, Url(path), destination);
+
+			bool matches = result && result.sha256 == expectedSHA256;
+			unlink(destination.c_str());
+
+			if (!matches) return std::nullopt;
+			return result.size;
+		});
+
+		HttpCache::RevalidateInterval = revalidateInterval;
+		Server->Unserve(path);
+		Report("DownloadFile " + name, measurement);
+
+		// Only the first request should have sent the file, everything after that should be a 304
+		printf("%-52s %llu of %llu requests were answered with 304 Not Modified\n", "", (unsigned long long)measurement.server.notModified, (unsigned long long)measurement.server.requests);
+	}
+
+	void BenchGetData(std::string name, uint64_t size, ServedFile served, size_t count, size_t concurrency) {
+		std::string path = "/" + name + ".json";
+
+		// Doesnt have to be valid json, GetData doesnt parse it
+		served.body = std::string(size, 'x');
+		std::string body = served.body;
+		Server->Serve(path, std::move(served));
+
+		static int runs = 0;
+		int run = runs++;
+
+		Measurement measurement = Measure(count, concurrency, [&](size_t index) -> std::optional<uint64_t> {
+			std::string data = WebUtils::GetData(Url(path + "?run=" + std::to_string(run) + "-" + std::to_string(index)));
+			if (data != body) return std::nullopt;
+
+			return data.size();
+		});
+
+		Server->Unserve(path);
+		Report("GetData " + name, measurement);
+	}
+
+	void BenchInstall(std::string name, uint64_t modSize, size_t count) {
+		std::string id = "bench-" + name;
+		std::string path = "/" + id + ".qmod";
+
+		ServedFile served;
+		served.body = MakeSyntheticQMod(id, modSize, 3);
+		served.etag = "\"" + id + "\"";
+		Server->Serve(path, std::move(served));
+
+		std::string modPath = ModIndex::ModsPath + "lib" + id + ".so";
+
+		Measurement measurement = Measure(count, 1, [&](size_t index) -> std::optional<uint64_t> {
+			std::string fileName = id + "-" + std::to_string(index) + ".qmod";
+
+			// InstallFromUrl detaches its thread and has no way of saying when its done, so this runs the same steps it does and waits for them
+			std::string downloadFileLoc = "/sdcard/BMBFData/Mods/Temp/Downloads/" + fileName;
+			if (!WebUtils::DownloadFile(fileName, Url(path + "?run=" + std::to_string(index)), downloadFileLoc)) return std::nullopt;
+
+			QMod* qmod = new QMod(downloadFileLoc, false);
+
+			std::optional<std::thread> thread = qmod->InstallAsync();
+			if (thread.has_value()) thread->join();
+
+			struct stat modStat;
+			bool installed = qmod->Installed() && stat(modPath.c_str(), &modStat) == 0 && (uint64_t)modStat.st_size == modSize;
+
+			// Remove it again, so the next run has to install it from scratch
+			std::optional<std::thread> uninstall = qmod->UninstallAsync(false, false);
+			if (uninstall.has_value()) uninstall->join();
+
+			if (!installed) return std::nullopt;
+			return modSize;
+		});
+
+		Server->Unserve(path);
+		Report("InstallFromUrl " + name, measurement);
+	}
+
+	int Run(Options options) {
+		char tempTemplate[] = "/tmp/modloader-utils-bench-XXXXXX";
+		if (mkdtemp(tempTemplate) == nullptr) {
+			fprintf(stderr, "Failed to make a temp directory\n");
+			return 1;
+		}
+
+		TempPath = std::string(tempTemplate) + "/";
+		FileUtils::MakeDirs(TempPath + "downloads/");
+
+		// The cache has to be on the same filesystem as the downloads, so keep it in the temp directory too
+		HttpCache::CachePath = TempPath + "cache/";
+
+		Server = std::make_unique<LoopbackServer>();
+		if (!Server->Valid()) {
+			fprintf(stderr, "Failed to start the loopback server\n");
+			return 1;
+		}
+
+		// The urls look like real ones, and the download engine sends them to the loopback server instead
+		WebUtils::DownloadEngine::SetConnectTo({Host + ":80:127.0.0.1:" + std::to_string(Server->Port())});
+
+		uint64_t KiB = 1024;
+		uint64_t MiB = 1024 * KiB;
+		size_t runs = options.quick ? 4 : 20;
+
+		ServedFile fast;
+
+		ServedFile slow;
+		slow.latency = std::chrono::milliseconds(20);
+
+		ServedFile limited;
+		limited.bytesPerSecond = (options.quick ? 16 : 32) * MiB;
+
+		ServedFile flaky;
+		flaky.failEvery = 2;
+
+		printf("Serving on 127.0.0.1:%u, working in %s\n\n", Server->Port(), TempPath.c_str());
+
+		BenchDownloads("256KiB", 256 * KiB, fast, runs * 4, 1, false);
+		BenchDownloads("256KiB-20ms-latency", 256 * KiB, slow, runs, 1, false);
+		BenchDownloads("256KiB-20ms-latency-8-at-once", 256 * KiB, slow, runs * 4, 8, false);
+		BenchDownloads("8MiB", 8 * MiB, fast, runs, 1, false);
+		BenchDownloads("8MiB-4-at-once", 8 * MiB, fast, runs, 4, false);
+
+		uint64_t bigSize = (options.quick ? 24 : 64) * MiB;
+		std::string bigName = std::to_string(bigSize / MiB) + "MiB";
+
+		BenchDownloads(bigName + "-bandwidth-limited", bigSize, limited, options.quick ? 1 : 3, 1, false);
+		BenchDownloads(bigName + "-bandwidth-limited-segmented", bigSize, limited, options.quick ? 1 : 3, 1, true);
+
+		BenchResume("8MiB-dropped-half-way", 8 * MiB, options.quick ? 2 : 5);
+		BenchRevalidation("1MiB-revalidated", MiB, runs);
+
+		BenchGetData("4KiB", 4 * KiB, fast, runs * 10, 1);
+		BenchGetData("4KiB-20ms-latency", 4 * KiB, slow, runs, 1);
+		BenchGetData("4KiB-20ms-latency-16-at-once", 4 * KiB, slow, runs * 8, 16);
+
+		// GetData doesnt retry, so half of these fail. This measures how quickly a failure comes back
+		{
+			std::string path = "/flaky.json";
+			flaky.body = "{}";
+			Server->Serve(path, flaky);
+
+			Measurement measurement = Measure(runs * 4, 1, [&](size_t index) -> std::optional<uint64_t> {
+				return WebUtils::GetData(Url(path + "?run=" + std::to_string(index))).size();
+			});
+
+			Server->Unserve(path);
+			Report("GetData 2B-every-other-request-fails", measurement);
+			printf("%-52s %llu of %llu requests failed\n", "", (unsigned long long)measurement.server.failures, (unsigned long long)measurement.server.requests);
+		}
+
+		if (options.install) {
+			BenchInstall("1MiB", MiB, runs);
+			BenchInstall("16MiB", 16 * MiB, options.quick ? 2 : 5);
+		}
+
+		Server.reset();
+		std::filesystem::remove_all(TempPath);
+
+		if (Failures > 0) {
+			fprintf(stderr, "\n%i benchmarks failed\n", Failures);
+			return 1;
+		}
+
+		return 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	Bench::Options options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--quick") {
+			options.quick = true;
+		} else if (arg == "--install") {
+			options.install = true;
+		} else if (arg == "--verbose") {
+			Bench::VerboseLogging = true;
+		} else {
+			fprintf(stderr, "Usage: %s [--quick] [--install] [--verbose]\n", argv[0]);
+			fprintf(stderr, "  --quick    Smaller files and fewer runs\n");
+			fprintf(stderr, "  --install  Also benchmark installing QMods. This writes to /sdcard like it does on the Quest, so only use it somewhere thats safe to do so\n");
+			fprintf(stderr, "  --verbose  Show ModloaderUtils' logs\n");
+			return 2;
+		}
+	}
+
+	return Bench::Run(options);
+}
@@ -0,0 +1,436 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace Bench {
+	// How a file is served, so the download code can be run against slow, unreliable or unhelpful servers
+	struct ServedFile {
+		std::string body;
+
+		// Sent as the ETag header, and checked against If-None-Match and If-Range. Empty means the server doesnt send one
+		std::string etag;
+		std::string lastModified;
+
+		// If false, Range headers are ignored and the whole file is always sent
+		bool ranges = true;
+
+		// How long the server waits before it starts responding
+		std::chrono::milliseconds latency = std::chrono::milliseconds(0);
+
+		// How fast each response's body is sent. 0 means as fast as possible
+		uint64_t bytesPerSecond = 0;
+
+		// Every failEvery'th request for the file gets failStatus instead. 0 means requests never fail
+		uint32_t failEvery = 0;
+		int failStatus = 503;
+
+		// The next dropCount responses are cut off, by closing the connection, once dropAfter bytes of the body have been sent
+		uint32_t dropCount = 0;
+		uint64_t dropAfter = 0;
+	};
+
+	struct ServerStats {
+		uint64_t requests = 0;
+		uint64_t rangeRequests = 0;
+		uint64_t notModified = 0;
+		uint64_t failures = 0;
+		uint64_t drops = 0;
+		uint64_t bodyBytes = 0;
+	};
+
+	/**
+	 * A small HTTP/1.1 server on localhost, which runs on its own threads in this process.
+	 * It only understands GET and HEAD, but supports keep-alive, Range, If-Range and If-None-Match, which is everything the download code uses.
+	 * Query strings are ignored when looking up a file, so a file can be given lots of urls that dont share a cache entry
+	 */
+	class LoopbackServer {
+		public:
+			LoopbackServer() {
+				m_Listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+				if (m_Listener < 0) return;
+
+				int reuse = 1;
+				setsockopt(m_Listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+				sockaddr_in address{};
+				address.sin_family = AF_INET;
+				address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+				address.sin_port = 0;
+
+				socklen_t addressSize = sizeof(address);
+				if (bind(m_Listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(m_Listener, 128) != 0 || getsockname(m_Listener, (sockaddr*)&address, &addressSize) != 0) {
+					close(m_Listener);
+					m_Listener = -1;
+					return;
+				}
+
+				m_Port = ntohs(address.sin_port);
+				m_AcceptThread = std::thread([this] { AcceptLoop(); });
+			}
+
+			~LoopbackServer() {
+				m_Stopping = true;
+
+				if (m_Listener >= 0) shutdown(m_Listener, SHUT_RDWR);
+				if (m_AcceptThread.joinable()) m_AcceptThread.join();
+				if (m_Listener >= 0) close(m_Listener);
+
+				std::vector<std::thread> connections;
+
+				{
+					std::unique_lock guard(m_Lock);
+
+					// Wakes up any connection that's waiting for its next request
+					for (int fd : m_OpenConnections) shutdown(fd, SHUT_RDWR);
+					connections = std::move(m_ConnectionThreads);
+				}
+
+				for (std::thread& connection : connections) connection.join();
+			}
+
+			LoopbackServer(const LoopbackServer&) = delete;
+			LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+			const inline bool Valid() const { return m_Listener >= 0; }
+			const inline uint16_t Port() const { return m_Port; }
+
+			/**
+			 * @brief Gets the url for a path on this server
+			 *
+			 * @param path The path, starting with a /
+			 */
+			std::string Url(std::string path) const {
+				return "http://127.0.0.1:" + std::to_string(m_Port) + path;
+			}
+
+			/**
+			 * @brief Starts serving a file, replacing whatever was served at the path before
+			 *
+			 * @param path The path to serve it at, starting with a /
+			 * @param file The file, and how to serve it
+			 */
+			void Serve(std::string path, ServedFile file) {
+				std::unique_lock guard(m_Lock);
+				m_Files[path] = std::make_shared<FileState>(std::move(file));
+			}
+
+			/**
+			 * @brief Stops serving a file, so its body is freed once any request still sending it finishes
+			 *
+			 * @param path The path it was served at
+			 */
+			void Unserve(std::string path) {
+				std::unique_lock guard(m_Lock);
+				m_Files.erase(path);
+			}
+
+			ServerStats GetStats() {
+				std::unique_lock guard(m_Lock);
+				return m_Stats;
+			}
+
+			void ResetStats() {
+				std::unique_lock guard(m_Lock);
+				m_Stats = {};
+			}
+
+		private:
+			struct FileState {
+				ServedFile file;
+				uint32_t requests = 0;
+				uint32_t dropsLeft;
+
+				FileState(ServedFile served) : file(std::move(served)), dropsLeft(file.dropCount) {}
+			};
+
+			struct Request {
+				std::string method;
+				std::string path;
+				std::unordered_map<std::string, std::string> headers;
+
+				std::string GetHeader(std::string name) const {
+					auto search = headers.find(name);
+					return search != headers.end() ? search->second : "";
+				}
+			};
+
+			void AcceptLoop() {
+				while (!m_Stopping) {
+					int fd = accept4(m_Listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+					if (fd < 0) {
+						if (errno == EINTR || errno == ECONNABORTED) continue;
+						return;
+					}
+
+					int noDelay = 1;
+					setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+					std::unique_lock guard(m_Lock);
+					if (m_Stopping) {
+						close(fd);
+						return;
+					}
+
+					m_OpenConnections.push_back(fd);
+					m_ConnectionThreads.emplace_back([this, fd] { HandleConnection(fd); });
+				}
+			}
+
+			void HandleConnection(int fd) {
+				std::string buffer;
+
+				while (!m_Stopping) {
+					std::optional<Request> request = ReadRequest(fd, buffer);
+					if (!request.has_value() || !Respond(fd, *request)) break;
+
+					if (request->GetHeader("connection") == "close") break;
+				}
+
+				std::unique_lock guard(m_Lock);
+				m_OpenConnections.erase(std::remove(m_OpenConnections.begin(), m_OpenConnections.end(), fd), m_OpenConnections.end());
+				close(fd);
+			}
+
+			static std::optional<Request> ReadRequest(int fd, std::string& buffer) {
+				size_t headerEnd;
+
+				while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+					char chunk[4096];
+					ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+
+					if (received < 0 && errno == EINTR) continue;
+					if (received <= 0 || buffer.size() > 64 * 1024) return std::nullopt;
+
+					buffer.append(chunk, received);
+				}
+
+				std::string head = buffer.substr(0, headerEnd);
+				buffer.erase(0, headerEnd + 4);
+
+				Request request;
+				size_t lineEnd = head.find("\r\n");
+				std::string requestLine = head.substr(0, lineEnd);
+
+				size_t methodEnd = requestLine.find(' ');
+				size_t pathEnd = requestLine.find(' ', methodEnd + 1);
+				if (methodEnd == std::string::npos || pathEnd == std::string::npos) return std::nullopt;
+
+				request.method = requestLine.substr(0, methodEnd);
+				request.path = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+				request.path = request.path.substr(0, request.path.find('?'));
+
+				while (lineEnd != std::string::npos) {
+					size_t lineStart = lineEnd + 2;
+					lineEnd = head.find("\r\n", lineStart);
+
+					std::string line = head.substr(lineStart, lineEnd == std::string::npos ? std::string::npos : lineEnd - lineStart);
+					size_t colon = line.find(':');
+					if (colon == std::string::npos) continue;
+
+					std::string name = line.substr(0, colon);
+					std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+					size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+					request.headers[name] = valueStart == std::string::npos ? "" : line.substr(valueStart);
+				}
+
+				return request;
+			}
+
+			// Returns false if the connection should be closed
+			bool Respond(int fd, const Request& request) {
+				std::shared_ptr<FileState> state;
+				bool fail = false;
+				bool drop = false;
+
+				{
+					std::unique_lock guard(m_Lock);
+					m_Stats.requests++;
+
+					auto search = m_Files.find(request.path);
+					if (search != m_Files.end()) {
+						state = search->second;
+						state->requests++;
+
+						fail = state->file.failEvery > 0 && state->requests % state->file.failEvery == 0;
+						if (fail) m_Stats.failures++;
+					}
+				}
+
+				if (request.method != "GET" && request.method != "HEAD") return SendHeaders(fd, 405, {}, 0);
+				if (state == nullptr) return SendHeaders(fd, 404, {}, 0);
+
+				const ServedFile& file = state->file;
+				if (file.latency.count() > 0) std::this_thread::sleep_for(file.latency);
+
+				if (fail) return SendHeaders(fd, file.failStatus, {}, 0);
+
+				std::vector<std::string> headers = {"Accept-Ranges: " + std::string(file.ranges ? "bytes" : "none")};
+				if (!file.etag.empty()) headers.push_back("ETag: " + file.etag);
+				if (!file.lastModified.empty()) headers.push_back("Last-Modified: " + file.lastModified);
+
+				std::string ifNoneMatch = request.GetHeader("if-none-match");
+				if (!file.etag.empty() && ifNoneMatch == file.etag) {
+					std::unique_lock guard(m_Lock);
+					m_Stats.notModified++;
+					guard.unlock();
+
+					return SendHeaders(fd, 304, headers, 0);
+				}
+
+				uint64_t size = file.body.size();
+				uint64_t start = 0;
+				uint64_t end = size;
+				int status = 200;
+
+				std::string range = request.GetHeader("range");
+				std::string ifRange = request.GetHeader("if-range");
+				bool rangeStillValid = ifRange.empty() || (!file.etag.empty() && ifRange == file.etag) || (!file.lastModified.empty() && ifRange == file.lastModified);
+
+				if (file.ranges && range.starts_with("bytes=") && rangeStillValid) {
+					unsigned long long first = 0;
+					unsigned long long last = 0;
+					int fields = sscanf(range.c_str() + 6, "%llu-%llu", &first, &last);
+
+					if (fields >= 1) {
+						if (first >= size) {
+							headers.push_back("Content-Range: bytes */" + std::to_string(size));
+							return SendHeaders(fd, 416, headers, 0);
+						}
+
+						start = first;
+						end = fields == 2 ? std::min<uint64_t>(last + 1, size) : size;
+						status = 206;
+
+						headers.push_back("Content-Range: bytes " + std::to_string(start) + "-" + std::to_string(end - 1) + "/" + std::to_string(size));
+
+						std::unique_lock guard(m_Lock);
+						m_Stats.rangeRequests++;
+					}
+				}
+
+				if (!SendHeaders(fd, status, headers, end - start)) return false;
+				if (request.method == "HEAD") return true;
+
+				{
+					std::unique_lock guard(m_Lock);
+					drop = state->dropsLeft > 0 && end - start > file.dropAfter;
+
+					if (drop) {
+						state->dropsLeft--;
+						m_Stats.drops++;
+					}
+				}
+
+				if (drop) end = start + file.dropAfter;
+
+				if (!SendBody(fd, file.body.data() + start, end - start, file.bytesPerSecond)) return false;
+
+				if (drop) {
+					shutdown(fd, SHUT_RDWR);
+					return false;
+				}
+
+				return true;
+			}
+
+			bool SendHeaders(int fd, int status, const std::vector<std::string>& headers, uint64_t contentLength) {
+				std::string response = "HTTP/1.1 " + std::to_string(status) + " " + StatusText(status) + "\r\n";
+				response += "Content-Length: " + std::to_string(contentLength) + "\r\n";
+
+				for (const std::string& header : headers) {
+					response += header + "\r\n";
+				}
+
+				response += "\r\n";
+				return SendAll(fd, response.data(), response.size());
+			}
+
+			bool SendBody(int fd, const char* data, uint64_t size, uint64_t bytesPerSecond) {
+				// Small enough chunks that a limited bandwidth comes out smooth, rather than in bursts
+				constexpr uint64_t chunkSize = 16 * 1024;
+				std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+				for (uint64_t sent = 0; sent < size;) {
+					uint64_t chunk = std::min(chunkSize, size - sent);
+					if (!SendAll(fd, data + sent, chunk)) return false;
+
+					sent += chunk;
+
+					{
+						std::unique_lock guard(m_Lock);
+						m_Stats.bodyBytes += chunk;
+					}
+
+					if (bytesPerSecond > 0) {
+						std::chrono::microseconds due((sent * 1000000) / bytesPerSecond);
+						std::this_thread::sleep_until(startTime + due);
+					}
+				}
+
+				return true;
+			}
+
+			static bool SendAll(int fd, const char* data, size_t size) {
+				while (size > 0) {
+					ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+
+					if (sent < 0 && errno == EINTR) continue;
+					if (sent <= 0) return false;
+
+					data += sent;
+					size -= sent;
+				}
+
+				return true;
+			}
+
+			static const char* StatusText(int status) {
+				switch (status) {
+					case 200: return "OK";
+					case 206: return "Partial Content";
+					case 304: return "Not Modified";
+					case 404: return "Not Found";
+					case 405: return "Method Not Allowed";
+					case 416: return "Range Not Satisfiable";
+					case 500: return "Internal Server Error";
+					case 503: return "Service Unavailable";
+					default: return "Unknown";
+				}
+			}
+
+			int m_Listener = -1;
+			uint16_t m_Port = 0;
+
+			std::atomic<bool> m_Stopping = false;
+			std::thread m_AcceptThread;
+
+			// Everything below is shared between the connection threads, so only touched while holding m_Lock
+			std::mutex m_Lock;
+			std::unordered_map<std::string, std::shared_ptr<FileState>> m_Files;
+			std::vector<int> m_OpenConnections;
+			std::vector<std::thread> m_ConnectionThreads;
+			ServerStats m_Stats;
+	};
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <zlib.h>
+
+namespace Bench {
+	/**
+	 * Builds zip archives in memory, for serving from a LoopbackServer without needing anything on disk
+	 */
+	class ZipBuilder {
+		public:
+			/**
+			 * @brief Adds a file to the archive
+			 *
+			 * @param name The file's path in the archive
+			 * @param data The file's contents
+			 * @param deflate If true, the file is compressed like most QMods are, otherwise it's stored as is
+			 */
+			void Add(std::string name, const std::string& data, bool deflate = true) {
+				uint32_t crc = crc32(0, (const Bytef*)data.data(), data.size());
+				std::string compressed = deflate ? Deflate(data) : data;
+
+				CentralRecord record{name, crc, (uint32_t)compressed.size(), (uint32_t)data.size(), (uint32_t)m_Data.size(), (uint16_t)(deflate ? 8 : 0)};
+
+				// Local file header
+				WriteU32(m_Data, 0x04034b50);
+				WriteU16(m_Data, 20);
+				WriteU16(m_Data, 0);
+				WriteU16(m_Data, record.method);
+				WriteU16(m_Data, 0);
+				WriteU16(m_Data, 0);
+				WriteU32(m_Data, record.crc);
+				WriteU32(m_Data, record.compressedSize);
+				WriteU32(m_Data, record.uncompressedSize);
+				WriteU16(m_Data, name.size());
+				WriteU16(m_Data, 0);
+
+				m_Data += name;
+				m_Data += compressed;
+
+				m_Records.push_back(record);
+			}
+
+			/**
+			 * @brief Finishes the archive, after which nothing else can be added
+			 *
+			 * @return The whole archive
+			 */
+			std::string Finish() {
+				std::string archive = m_Data;
+				uint32_t directoryOffset = archive.size();
+
+				for (const CentralRecord& record : m_Records) {
+					WriteU32(archive, 0x02014b50);
+					WriteU16(archive, 20);
+					WriteU16(archive, 20);
+					WriteU16(archive, 0);
+					WriteU16(archive, record.method);
+					WriteU16(archive, 0);
+					WriteU16(archive, 0);
+					WriteU32(archive, record.crc);
+					WriteU32(archive, record.compressedSize);
+					WriteU32(archive, record.uncompressedSize);
+					WriteU16(archive, record.name.size());
+					WriteU16(archive, 0);
+					WriteU16(archive, 0);
+					WriteU16(archive, 0);
+					WriteU16(archive, 0);
+					WriteU32(archive, 0);
+					WriteU32(archive, record.localHeaderOffset);
+
+					archive += record.name;
+				}
+
+				uint32_t directorySize = archive.size() - directoryOffset;
+
+				// End of central directory
+				WriteU32(archive, 0x06054b50);
+				WriteU16(archive, 0);
+				WriteU16(archive, 0);
+				WriteU16(archive, m_Records.size());
+				WriteU16(archive, m_Records.size());
+				WriteU32(archive, directorySize);
+				WriteU32(archive, directoryOffset);
+				WriteU16(archive, 0);
+
+				return archive;
+			}
+
+		private:
+			struct CentralRecord {
+				std::string name;
+				uint32_t crc;
+				uint32_t compressedSize;
+				uint32_t uncompressedSize;
+				uint32_t localHeaderOffset;
+				uint16_t method;
+			};
+
+			static std::string Deflate(const std::string& data) {
+				z_stream stream{};
+
+				// Negative window bits gives a raw deflate stream, which is what zips hold
+				deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+				std::string compressed(deflateBound(&stream, data.size()), '\0');
+				stream.next_in = (Bytef*)data.data();
+				stream.avail_in = data.size();
+				stream.next_out = (Bytef*)compressed.data();
+				stream.avail_out = compressed.size();
+
+				deflate(&stream, Z_FINISH);
+				compressed.resize(stream.total_out);
+				deflateEnd(&stream);
+
+				return compressed;
+			}
+
+			static void WriteU16(std::string& out, uint16_t value) {
+				out += (char)(value & 0xFF);
+				out += (char)(value >> 8);
+			}
+
+			static void WriteU32(std::string& out, uint32_t value) {
+				WriteU16(out, value & 0xFFFF);
+				WriteU16(out, value >> 16);
+			}
+
+			std::string m_Data;
+			std::vector<CentralRecord> m_Records;
+	};
+
+	/**
+	 * @brief Makes some data that compresses about as well as a real mod's .so does
+	 *
+	 * @param size How many bytes to make
+	 * @param seed Different seeds give different data, so files dont all end up with the same hash
+	 */
+	inline std::string MakeSyntheticData(uint64_t size, uint32_t seed) {
+		std::string data(size, '\0');
+		uint32_t state = seed * 2654435761u + 1;
+
+		for (uint64_t i = 0; i < size; i++) {
+			// xorshift32, limited to 32 values so deflate can roughly halve it
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+
+			data[i] = (char)(state & 0x1F);
+		}
+
+		return data;
+	}
+
+	/**
+	 * @brief Makes a Beat Saber QMod with one mod file, and no dependencies
+	 *
+	 * @param id The QMod's ID. The mod file is called lib<id>.so
+	 * @param modSize How big the mod file is, before it's compressed
+	 * @param seed Changes the mod file's contents
+	 * @return The whole .qmod
+	 */
+	inline std::string MakeSyntheticQMod(std::string id, uint64_t modSize, uint32_t seed) {
+		std::string modFile = "lib" + id + ".so";
+
+		std::string modJson = "{"
+			"\"_QPVersion\": \"0.1.1\", "
+			"\"name\": \"" + id + "\", "
+			"\"id\": \"" + id + "\", "
+			"\"author\": \"Bench\", "
+			"\"version\": \"1.0.0\", "
+			"\"packageId\": \"com.beatgames.beatsaber\", "
+			"\"packageVersion\": \"1.0.0\", "
+			"\"modFiles\": [\"" + modFile + "\"], "
+			"\"libraryFiles\": [], "
+			"\"dependencies\": [], "
+			"\"fileCopies\": []"
+		"}";
+
+		ZipBuilder builder;
+		builder.Add("mod.json", modJson);
+		builder.Add(modFile, MakeSyntheticData(modSize, seed));
+
+		return builder.Finish();
+	}
+}
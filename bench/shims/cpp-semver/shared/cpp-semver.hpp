@@ -0,0 +1,11 @@
+#pragma once
+
+// Stands in for cpp-semver on the host. The benchmark QMods have no dependencies, so versions are never actually compared
+
+#include <string>
+
+namespace semver {
+	inline bool satisfies(const std::string& version, const std::string& range) {
+		return true;
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Stands in for jni-utils on the host, where there's no JVM to ask. Only what the headers use is here
+
+#include <string>
+
+struct _JNIEnv;
+typedef _JNIEnv JNIEnv;
+typedef const std::string* jstring;
+
+namespace JNIUtils {
+	inline JNIEnv* GetJNIEnv() {
+		return nullptr;
+	}
+
+	// The benchmarks only ever install Beat Saber QMods
+	inline jstring GetPackageName(JNIEnv* env) {
+		static const std::string packageName = "com.beatgames.beatsaber";
+		return &packageName;
+	}
+
+	inline std::string ToString(JNIEnv* env, jstring string) {
+		return string != nullptr ? *string : "";
+	}
+}
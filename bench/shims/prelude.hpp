@@ -0,0 +1,48 @@
+#pragma once
+
+// Stands in for what beatsaber-hook gives a mod on the Quest, which the headers expect to already be declared
+
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstdarg>
+
+namespace Bench {
+	// Logs are off by default, as the benchmarks make failures on purpose and the noise hides the results
+	inline bool VerboseLogging = false;
+}
+
+struct Logger {
+	void info(const char* format, ...) { va_list args; va_start(args, format); Log("info", format, args); va_end(args); }
+	void debug(const char* format, ...) { va_list args; va_start(args, format); Log("debug", format, args); va_end(args); }
+	void warning(const char* format, ...) { va_list args; va_start(args, format); Log("warning", format, args); va_end(args); }
+	void error(const char* format, ...) { va_list args; va_start(args, format); Log("error", format, args); va_end(args); }
+	void critical(const char* format, ...) { va_list args; va_start(args, format); Log("critical", format, args); va_end(args); }
+
+private:
+	static void Log(const char* level, const char* format, va_list args) {
+		if (!Bench::VerboseLogging) return;
+
+		fprintf(stderr, "[%s] ", level);
+		vfprintf(stderr, format, args);
+		fputc('\n', stderr);
+	}
+};
+
+inline Logger& getLogger() {
+	static Logger logger;
+	return logger;
+}
+
+template<typename... TArgs>
+std::string string_format(const std::string_view format, TArgs... args) {
+	std::string formatString(format);
+
+	int size = snprintf(nullptr, 0, formatString.c_str(), args...);
+	if (size <= 0) return "";
+
+	std::string result(size, '\0');
+	snprintf(result.data(), size + 1, formatString.c_str(), args...);
+
+	return result;
+}
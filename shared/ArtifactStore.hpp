@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "modloader-utils/shared/FileUtils.hpp"
+#include "modloader-utils/shared/HashUtils.hpp"
+
+namespace ModloaderUtils {
+	/**
+	 * A content addressed store of files that have already been extracted from a QMod.
+	 * When a QMod is disabled its files are moved in here instead of being deleted, so enabling it again is just a hard link, or a copy if the filesystem doesnt support them.
+	 * Files are keyed by their SHA-256, so a file is only ever restored if its contents are exactly what the QMod ships.
+	 * They're grouped into buckets by their size and CRC32, which are read from a QMod's central directory, so a file that was never stored can be ruled out without inflating anything.
+	 * The store lives next to the mods and libs folders so moving files in and out never has to cross filesystems
+	 */
+	namespace ArtifactStore {
+		inline const std::string StorePath = "/sdcard/Android/data/com.beatgames.beatsaber/files/modloader-utils-store/";
+
+		// Private shit dont use >:(
+
+		inline std::string GetBucketPath(uint64_t size, uint32_t crc) {
+			char key[32];
+			snprintf(key, sizeof(key), "%08x-%llu/", crc, (unsigned long long)size);
+
+			return StorePath + key;
+		}
+
+		/**
+		 * @brief Gets where a file with specific contents would be kept in the store
+		 *
+		 * @param size The size of the file
+		 * @param crc The CRC32 of the file
+		 * @param sha256 The SHA-256 of the file, in lower case hex
+		 * @return The path to the file in the store
+		 */
+		inline std::string GetArtifactPath(uint64_t size, uint32_t crc, std::string sha256) {
+			return GetBucketPath(size, crc) + sha256;
+		}
+
+		/**
+		 * @brief Checks if the store might have a file with a specific size and CRC32
+		 * @details This is just a stat, so it's worth calling before hashing anything. If it returns true, use HasArtifact to be sure
+		 *
+		 * @param size The size of the file
+		 * @param crc The CRC32 of the file
+		 * @return Returns false if the store definitely doesnt have the file
+		 */
+		inline bool MightHaveArtifact(uint64_t size, uint32_t crc) {
+			struct stat bucketStat;
+			return stat(GetBucketPath(size, crc).c_str(), &bucketStat) == 0 && S_ISDIR(bucketStat.st_mode);
+		}
+
+		/**
+		 * @brief Checks if the store has a file with specific contents
+		 *
+		 * @param size The size of the file
+		 * @param crc The CRC32 of the file
+		 * @param sha256 The SHA-256 of the file, in lower case hex
+		 * @return Returns true if the file is in the store
+		 */
+		inline bool HasArtifact(uint64_t size, uint32_t crc, std::string sha256) {
+			struct stat fileStat;
+			return stat(GetArtifactPath(size, crc, sha256).c_str(), &fileStat) == 0 && (uint64_t)fileStat.st_size == size;
+		}
+
+		/**
+		 * @brief Moves an installed file into the store, so that it can be restored later without extracting it again
+		 * @details If the file has been modified since it was installed, or the store already has a copy, the file is just deleted
+		 *
+		 * @param path The installed file
+		 * @param size The size the file should be
+		 * @param crc The CRC32 the file should have
+		 * @return Returns true if the store has a copy of the file afterwards
+		 */
+		inline bool Stash(std::string path, uint64_t size, uint32_t crc) {
+			std::optional<std::string> sha256;
+			if (HashUtils::FileMatches(path, size, crc)) sha256 = HashUtils::SHA256File(path);
+
+			if (!sha256.has_value()) {
+				unlink(path.c_str());
+				return false;
+			}
+
+			if (HasArtifact(size, crc, *sha256)) {
+				unlink(path.c_str());
+				return true;
+			}
+
+			std::string artifactPath = GetArtifactPath(size, crc, *sha256);
+			if (FileUtils::MakeDirs(FileUtils::GetParentDir(artifactPath)) && rename(path.c_str(), artifactPath.c_str()) == 0) return true;
+
+			unlink(path.c_str());
+			return false;
+		}
+
+		/**
+		 * @brief Puts a file from the store back at its install location
+		 * @details The file is hard linked if possible, otherwise it is copied, so the store always keeps its copy for any other QMod that ships the same file
+		 *
+		 * @param size The size of the file
+		 * @param crc The CRC32 of the file
+		 * @param sha256 The SHA-256 the file must have, in lower case hex
+		 * @param destination Where to put the file
+		 * @return Returns true if the file was restored. If false, the file has to be extracted instead
+		 */
+		inline bool Restore(uint64_t size, uint32_t crc, std::string sha256, std::string destination) {
+			if (!HasArtifact(size, crc, sha256)) return false;
+
+			// Whatever was at the destination before is replaced, as we dont want it anyway
+			if (!FileUtils::LinkOrCopy(GetArtifactPath(size, crc, sha256), destination)) return false;
+
+			HashUtils::CacheFileCRC32(destination, crc);
+			return true;
+		}
+
+		/**
+		 * @brief Removes a file from the store
+		 * @details Other files with the same size and CRC32 are left alone, as they belong to other QMods
+		 *
+		 * @param size The size of the file
+		 * @param crc The CRC32 of the file
+		 * @param sha256 The SHA-256 of the file, in lower case hex
+		 */
+		inline void Remove(uint64_t size, uint32_t crc, std::string sha256) {
+			unlink(GetArtifactPath(size, crc, sha256).c_str());
+
+			// Only succeeds once the bucket is empty
+			rmdir(GetBucketPath(size, crc).c_str());
+		}
+	}
+}
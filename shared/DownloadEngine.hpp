@@ -0,0 +1,419 @@
+#pragma once
+
+#include "libcurl/shared/curl.h"
+
+#include "modloader-utils/shared/Types/WebRequest.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+
+namespace ModloaderUtils {
+	namespace WebUtils {
+		/**
+		 * Runs every web request on a single thread using curl_multi.
+		 * Connections, DNS lookups and TLS sessions are kept alive between requests, and requests to the same host are multiplexed over HTTP/2 where the server supports it.
+		 * Only a limited number of requests run at once, and waiting requests are started highest priority first, then in the order they were submitted.
+		 * Request callbacks run on the engine thread, so they should be quick, and must never wait on another request
+		 */
+		class DownloadEngine {
+		public:
+			// The most requests that can be transferring at once. Anything else waits in the queue
+			inline static size_t MaxActiveTransfers = 8;
+
+			// How many idle curl handles to keep around for reuse
+			inline static size_t MaxIdleHandles = 8;
+
+			// The receive buffer size for each transfer, which is also the biggest chunk onData will be given
+			inline static long TransferBufferSize = 64 * 1024;
+
+			// How often a request's onProgress is called while it is downloading
+			inline static std::chrono::milliseconds ProgressInterval = std::chrono::milliseconds(250);
+
+			/**
+			 * @brief Sends requests for some hosts somewhere else, without changing any urls
+			 * @details Meant for pointing real download links at a local server for testing. It should be set before making the first request,
+			 * as it is only read when a request starts transferring, so anything already queued or transferring may still go to the old place
+			 *
+			 * @param connectTo Each entry is in curl's CONNECT_TO format, "host:port:connect-to-host:connect-to-port"
+			 */
+			static void SetConnectTo(std::vector<std::string> connectTo) {
+				std::unique_lock guard(ConnectToLock);
+				ConnectTo = std::move(connectTo);
+			}
+
+			/**
+			 * @brief Gets the engine, starting it if it isnt running yet
+			 */
+			static DownloadEngine& Get() {
+				// Never destroyed, as the engine thread runs for the lifetime of the process
+				static DownloadEngine* engine = new DownloadEngine();
+				return *engine;
+			}
+
+			/**
+			 * @brief Queues a request, which reports back through its onComplete callback
+			 *
+			 * @param request The request to run
+			 */
+			void Submit(WebRequest request) {
+				{
+					std::unique_lock guard(m_Lock);
+					m_PendingRequests.emplace(request.priority, std::move(request));
+				}
+
+				curl_multi_wakeup(m_Multi);
+			}
+
+			/**
+			 * @brief Queues a request, and gets a future for its response
+			 * @details The request's own onComplete callback is still called, before the future is ready
+			 *
+			 * @param request The request to run
+			 * @return A future which is ready once the request has finished
+			 */
+			std::future<WebResponse> SubmitAsync(WebRequest request) {
+				auto promise = std::make_shared<std::promise<WebResponse>>();
+				std::future<WebResponse> future = promise->get_future();
+
+				request.onComplete = [promise, onComplete = std::move(request.onComplete)](WebResponse response) {
+					if (onComplete) onComplete(response);
+					promise->set_value(response);
+				};
+
+				Submit(std::move(request));
+				return future;
+			}
+
+			/**
+			 * @brief Gets the totals for every host that has been sent a request, keyed by host name
+			 * @details Redirects are counted against the host that was redirected to, so a CDN shows up as itself rather than as the site that linked to it
+			 */
+			std::unordered_map<std::string, HostStats> GetHostStats() {
+				std::unique_lock guard(m_StatsLock);
+				return m_HostStats;
+			}
+
+		private:
+			// Set from any thread through SetConnectTo, and read on the engine thread, so only touched while holding ConnectToLock
+			inline static std::mutex ConnectToLock;
+			inline static std::vector<std::string> ConnectTo;
+
+			struct Transfer {
+				WebRequest request;
+				WebResponse response;
+
+				CURL* handle = nullptr;
+				curl_slist* headers = nullptr;
+				curl_slist* connectTo = nullptr;
+
+				bool receivedBody = false;
+
+				std::chrono::steady_clock::time_point startTime;
+				std::chrono::steady_clock::time_point lastProgressTime;
+				uint64_t lastProgressBytes = 0;
+			};
+
+			DownloadEngine() {
+				curl_global_init(CURL_GLOBAL_DEFAULT);
+
+				m_Multi = curl_multi_init();
+
+				// Let requests to the same host share one connection where possible, rather than opening a new one for each
+				curl_multi_setopt(m_Multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+				curl_multi_setopt(m_Multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)MaxActiveTransfers);
+				curl_multi_setopt(m_Multi, CURLMOPT_MAXCONNECTS, (long)MaxActiveTransfers * 2);
+
+				std::thread(&DownloadEngine::Run, this).detach();
+			}
+
+			void Run() {
+				while (true) {
+					StartPendingTransfers();
+
+					int runningTransfers = 0;
+					curl_multi_perform(m_Multi, &runningTransfers);
+
+					CURLMsg* message;
+					int messagesLeft;
+
+					while ((message = curl_multi_info_read(m_Multi, &messagesLeft)) != nullptr) {
+						if (message->msg != CURLMSG_DONE) continue;
+
+						// The message is freed once the handle is removed, so grab everything we need first
+						CURL* handle = message->easy_handle;
+						CURLcode result = message->data.result;
+
+						FinishTransfer(handle, result);
+					}
+
+					// Sleeps until theres socket activity, a timeout, or Submit wakes us up
+					curl_multi_poll(m_Multi, nullptr, 0, 1000, nullptr);
+				}
+			}
+
+			void StartPendingTransfers() {
+				while (m_ActiveTransfers.size() < MaxActiveTransfers) {
+					std::unique_ptr<Transfer> transfer = std::make_unique<Transfer>();
+
+					{
+						std::unique_lock guard(m_Lock);
+						if (m_PendingRequests.empty()) return;
+
+						auto next = m_PendingRequests.begin();
+						transfer->request = std::move(next->second);
+						m_PendingRequests.erase(next);
+					}
+
+					CURL* handle = AcquireHandle();
+					if (handle == nullptr) {
+						getLogger().error("Curl failed to initialize for url \"%s\". No futher info was given", transfer->request.url.c_str());
+
+						WebResponse response;
+						response.result = CURLE_FAILED_INIT;
+
+						if (transfer->request.onComplete) transfer->request.onComplete(response);
+						continue;
+					}
+
+					transfer->handle = handle;
+
+					curl_easy_setopt(handle, CURLOPT_URL, transfer->request.url.c_str());
+					curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, OnWrite);
+					curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer.get());
+					curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, OnHeader);
+					curl_easy_setopt(handle, CURLOPT_HEADERDATA, transfer.get());
+					curl_easy_setopt(handle, CURLOPT_BUFFERSIZE, TransferBufferSize);
+					curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, false);
+					curl_easy_setopt(handle, CURLOPT_FAILONERROR, transfer->request.failOnError ? 1L : 0L);
+					curl_easy_setopt(handle, CURLOPT_NOBODY, transfer->request.noBody ? 1L : 0L);
+
+					// Follow HTTP redirects if necessary.
+					curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+
+					if (transfer->request.multiplex) {
+						// Prefer HTTP/2, and wait for an existing connection to the host rather than opening another one
+						curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+						curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+					} else {
+						// HTTP/1.1 connections only carry one request at a time, so this gets a connection to itself
+						curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+					}
+
+					curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+					transfer->startTime = std::chrono::steady_clock::now();
+					transfer->lastProgressTime = transfer->startTime;
+
+					if (transfer->request.onProgress) {
+						curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, OnProgress);
+						curl_easy_setopt(handle, CURLOPT_XFERINFODATA, transfer.get());
+						curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
+					}
+
+					for (std::string& header : transfer->request.headers) {
+						transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+					}
+
+					if (transfer->headers != nullptr) curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer->headers);
+
+					{
+						std::unique_lock guard(ConnectToLock);
+						for (std::string& connectTo : ConnectTo) {
+							transfer->connectTo = curl_slist_append(transfer->connectTo, connectTo.c_str());
+						}
+					}
+
+					if (transfer->connectTo != nullptr) curl_easy_setopt(handle, CURLOPT_CONNECT_TO, transfer->connectTo);
+
+					curl_multi_add_handle(m_Multi, handle);
+					m_ActiveTransfers.emplace(handle, std::move(transfer));
+				}
+			}
+
+			void FinishTransfer(CURL* handle, CURLcode result) {
+				curl_multi_remove_handle(m_Multi, handle);
+
+				auto search = m_ActiveTransfers.find(handle);
+				if (search == m_ActiveTransfers.end()) return;
+
+				std::unique_ptr<Transfer> transfer = std::move(search->second);
+				m_ActiveTransfers.erase(search);
+
+				WebResponse response = std::move(transfer->response);
+				response.result = result;
+				curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.httpCode);
+
+				response.stats = GetTransferStats(handle, transfer->request.url);
+				RecordHostStats(response);
+
+				// Make sure the last update always shows everything that was downloaded
+				if (transfer->request.onProgress && response.Success()) ReportProgress(transfer.get(), response.stats.bytesReceived, response.stats.bytesReceived);
+
+				if (transfer->headers != nullptr) curl_slist_free_all(transfer->headers);
+				if (transfer->connectTo != nullptr) curl_slist_free_all(transfer->connectTo);
+				ReleaseHandle(handle);
+
+				if (transfer->request.onComplete) transfer->request.onComplete(response);
+			}
+
+			CURL* AcquireHandle() {
+				if (m_IdleHandles.empty()) return curl_easy_init();
+
+				CURL* handle = m_IdleHandles.back();
+				m_IdleHandles.pop_back();
+
+				return handle;
+			}
+
+			void ReleaseHandle(CURL* handle) {
+				if (m_IdleHandles.size() >= MaxIdleHandles) {
+					curl_easy_cleanup(handle);
+					return;
+				}
+
+				// Resetting keeps the handle's caches, but clears every option so the next request starts fresh
+				curl_easy_reset(handle);
+				m_IdleHandles.push_back(handle);
+			}
+
+			static TransferStats GetTransferStats(CURL* handle, std::string requestUrl) {
+				TransferStats stats;
+
+				char* effectiveUrl = nullptr;
+				curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+				stats.host = GetHost(effectiveUrl != nullptr ? effectiveUrl : requestUrl);
+
+				curl_off_t value = 0;
+				if (curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &value) == CURLE_OK) stats.bytesReceived = value;
+
+				// Times are given in microseconds
+				if (curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &value) == CURLE_OK) stats.connectTime = value / 1000000.0;
+				if (curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &value) == CURLE_OK && value > 0) stats.tlsTime = value / 1000000.0 - stats.connectTime;
+				if (curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &value) == CURLE_OK) stats.timeToFirstByte = value / 1000000.0;
+				if (curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &value) == CURLE_OK) stats.totalTime = value / 1000000.0;
+
+				return stats;
+			}
+
+			static std::string GetHost(std::string url) {
+				size_t hostStart = url.find("://");
+				hostStart = hostStart == std::string::npos ? 0 : hostStart + 3;
+
+				size_t hostEnd = url.find_first_of(":/?#", hostStart);
+				return url.substr(hostStart, hostEnd == std::string::npos ? std::string::npos : hostEnd - hostStart);
+			}
+
+			void RecordHostStats(const WebResponse& response) {
+				std::unique_lock guard(m_StatsLock);
+				HostStats& hostStats = m_HostStats[response.stats.host];
+
+				hostStats.requests++;
+				if (!response.Success()) hostStats.failedRequests++;
+
+				if (response.stats.connectTime > 0) {
+					hostStats.newConnections++;
+					hostStats.totalConnectTime += response.stats.connectTime;
+					hostStats.totalTlsTime += response.stats.tlsTime;
+				}
+
+				hostStats.bytesReceived += response.stats.bytesReceived;
+				hostStats.totalTimeToFirstByte += response.stats.timeToFirstByte;
+				hostStats.totalTime += response.stats.totalTime;
+			}
+
+			static void ReportProgress(Transfer* transfer, uint64_t bytesDone, uint64_t bytesTotal) {
+				std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+				double sinceLastUpdate = std::chrono::duration<double>(now - transfer->lastProgressTime).count();
+				double sinceStart = std::chrono::duration<double>(now - transfer->startTime).count();
+
+				TransferProgress progress;
+				progress.bytesDone = bytesDone;
+				progress.bytesTotal = bytesTotal;
+				progress.currentRate = sinceLastUpdate > 0 ? (bytesDone - transfer->lastProgressBytes) / sinceLastUpdate : 0;
+				progress.averageRate = sinceStart > 0 ? bytesDone / sinceStart : 0;
+
+				transfer->lastProgressTime = now;
+				transfer->lastProgressBytes = bytesDone;
+
+				transfer->request.onProgress(progress);
+			}
+
+			static int OnProgress(void* userData, curl_off_t downloadTotal, curl_off_t downloadNow, curl_off_t uploadTotal, curl_off_t uploadNow) {
+				Transfer* transfer = (Transfer*)userData;
+
+				// curl calls this far more often than anyone needs to know
+				if (std::chrono::steady_clock::now() - transfer->lastProgressTime < ProgressInterval) return 0;
+
+				ReportProgress(transfer, downloadNow, downloadTotal);
+				return 0;
+			}
+
+			static size_t OnWrite(char* data, size_t size, size_t nmemb, void* userData) {
+				Transfer* transfer = (Transfer*)userData;
+				size_t length = size * nmemb;
+
+				// The headers are all in by the time the first bit of body arrives
+				if (!transfer->receivedBody) {
+					transfer->receivedBody = true;
+					curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &transfer->response.httpCode);
+
+					if (transfer->request.onResponse && !transfer->request.onResponse(transfer->response)) return 0;
+				}
+
+				if (transfer->request.onData && !transfer->request.onData(data, length)) return 0;
+				return length;
+			}
+
+			static size_t OnHeader(char* data, size_t size, size_t nmemb, void* userData) {
+				Transfer* transfer = (Transfer*)userData;
+				size_t length = size * nmemb;
+
+				std::string line(data, length);
+
+				// Each status line is a new response (like after a redirect), and we only want the headers of the last one
+				if (line.starts_with("HTTP/")) {
+					transfer->response.headers.clear();
+					return length;
+				}
+
+				size_t colon = line.find(':');
+				if (colon == std::string::npos) return length;
+
+				std::string name = line.substr(0, colon);
+				std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+				size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+				size_t valueEnd = line.find_last_not_of(" \t\r\n");
+
+				std::string value = valueStart != std::string::npos && valueEnd >= valueStart ? line.substr(valueStart, valueEnd - valueStart + 1) : "";
+				transfer->response.headers[name] = value;
+
+				return length;
+			}
+
+			CURLM* m_Multi;
+
+			// Shared with Submit, so only touched while holding m_Lock. Higher priorities come first, and equal priorities keep the order they were added
+			std::mutex m_Lock;
+			std::multimap<RequestPriority, WebRequest, std::greater<RequestPriority>> m_PendingRequests;
+
+			// Only ever touched on the engine thread
+			std::unordered_map<CURL*, std::unique_ptr<Transfer>> m_ActiveTransfers;
+			std::vector<CURL*> m_IdleHandles;
+
+			std::mutex m_StatsLock;
+			std::unordered_map<std::string, HostStats> m_HostStats;
+		};
+	}
+}
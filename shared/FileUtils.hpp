@@ -0,0 +1,204 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace ModloaderUtils {
+	namespace FileUtils {
+		/**
+		 * @brief Gets the directory part of a path
+		 *
+		 * @param path The path to get the directory of
+		 * @return Everything before the last slash, or an empty string if there isnt one
+		 */
+		inline std::string GetParentDir(std::string path) {
+			size_t lastSlash = path.find_last_of("/\\");
+			if (lastSlash == std::string::npos) return "";
+
+			return path.substr(0, lastSlash);
+		}
+
+		/**
+		 * @brief Creates a directory and all of its parents, the same as "mkdir -p" but without spawning a process
+		 *
+		 * @param path The directory to create
+		 * @return Returns true if the directory exists afterwards
+		 */
+		inline bool MakeDirs(std::string path) {
+			if (path.empty()) return true;
+
+			for (size_t i = 1; i <= path.size(); i++) {
+				if (i != path.size() && path[i] != '/') continue;
+
+				std::string subPath = path.substr(0, i);
+				if (mkdir(subPath.c_str(), 0777) != 0 && errno != EEXIST) return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Writes a whole buffer to a file descriptor, retrying on short writes
+		 *
+		 * @param fd The file descriptor to write to
+		 * @param data The data to write
+		 * @param size The number of bytes to write
+		 * @return Returns true if every byte was written
+		 */
+		inline bool WriteAll(int fd, const void* data, size_t size) {
+			const char* bytes = (const char*)data;
+
+			while (size > 0) {
+				ssize_t written = write(fd, bytes, size);
+				if (written < 0) {
+					if (errno == EINTR) continue;
+					return false;
+				}
+
+				bytes += written;
+				size -= written;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Writes a whole buffer to a specific offset in a file, without moving the file descriptor's position
+		 * @details Several threads or transfers can write to different parts of the same file at once this way
+		 *
+		 * @param fd The file descriptor to write to
+		 * @param data The data to write
+		 * @param size The number of bytes to write
+		 * @param offset Where in the file to write the data
+		 * @return Returns true if every byte was written
+		 */
+		inline bool WriteAllAt(int fd, const void* data, size_t size, off_t offset) {
+			const char* bytes = (const char*)data;
+
+			while (size > 0) {
+				ssize_t written = pwrite(fd, bytes, size, offset);
+				if (written < 0) {
+					if (errno == EINTR) continue;
+					return false;
+				}
+
+				bytes += written;
+				size -= written;
+				offset += written;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief A file that is written next to its destination, and only replaces it once it is complete
+		 * @details Data is written to a hidden temp file in the destination's directory, which is then fsynced and renamed over the destination.
+		 * As the rename is atomic, anything reading the destination will either see the old file or the complete new one, never half of one.
+		 * If the file is never committed, the temp file is removed when this is destroyed
+		 */
+		class AtomicFile {
+		public:
+			AtomicFile(std::string destination) : m_Destination(destination) {
+				std::string parentDir = GetParentDir(destination);
+				if (!MakeDirs(parentDir)) return;
+
+				std::string fileName = destination.substr(parentDir.empty() ? 0 : parentDir.size() + 1);
+				m_TempPath = (parentDir.empty() ? "" : parentDir + "/") + "." + fileName + ".XXXXXX";
+
+				m_Fd = mkstemp(m_TempPath.data());
+				if (m_Fd < 0) return;
+
+				// mkstemp only gives the owner access, so match what a normal file would get
+				fchmod(m_Fd, 0644);
+			}
+
+			~AtomicFile() {
+				if (m_Fd >= 0) {
+					close(m_Fd);
+					unlink(m_TempPath.c_str());
+				}
+			}
+
+			AtomicFile(const AtomicFile&) = delete;
+			AtomicFile& operator=(const AtomicFile&) = delete;
+
+			const inline bool Valid() const { return m_Fd >= 0; }
+			const inline int Descriptor() const { return m_Fd; }
+			const inline std::string& Destination() const { return m_Destination; }
+
+			bool Write(const void* data, size_t size) {
+				return m_Fd >= 0 && WriteAll(m_Fd, data, size);
+			}
+
+			/**
+			 * @brief Flushes the file to storage and moves it over the destination
+			 *
+			 * @return Returns true if the destination now holds the new file
+			 */
+			bool Commit() {
+				if (m_Fd < 0) return false;
+
+				bool success = fsync(m_Fd) == 0;
+				success = close(m_Fd) == 0 && success;
+				m_Fd = -1;
+
+				if (success) success = rename(m_TempPath.c_str(), m_Destination.c_str()) == 0;
+				if (!success) unlink(m_TempPath.c_str());
+
+				return success;
+			}
+
+		private:
+			std::string m_Destination;
+			std::string m_TempPath;
+
+			int m_Fd = -1;
+		};
+
+		/**
+		 * @brief Hard links a file to another path, or copies it there if the filesystem doesnt support hard links
+		 * @details Whatever was at the destination is replaced. A copy is written with an AtomicFile, so the destination is never left half written
+		 *
+		 * @param source The file to link or copy
+		 * @param destination Where to put it
+		 * @return Returns true if the destination now has the same contents as the source
+		 */
+		inline bool LinkOrCopy(std::string source, std::string destination) {
+			if (!MakeDirs(GetParentDir(destination))) return false;
+
+			// link() wont replace an existing file
+			if (unlink(destination.c_str()) != 0 && errno != ENOENT) return false;
+			if (link(source.c_str(), destination.c_str()) == 0) return true;
+
+			int fd = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return false;
+
+			AtomicFile file(destination);
+
+			constexpr size_t bufferSize = 256 * 1024;
+			std::unique_ptr<char[]> buffer(new char[bufferSize]);
+
+			while (file.Valid()) {
+				ssize_t bytesRead = read(fd, buffer.get(), bufferSize);
+				if (bytesRead < 0 && errno == EINTR) continue;
+
+				if (bytesRead < 0 || (bytesRead > 0 && !file.Write(buffer.get(), bytesRead))) {
+					close(fd);
+					return false;
+				}
+
+				if (bytesRead == 0) break;
+			}
+
+			close(fd);
+			return file.Commit();
+		}
+	}
+}
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace ModloaderUtils {
+	namespace HashUtils {
+#if defined(__aarch64__)
+		/**
+		 * @brief Checks if the CPU has the ARMv8 CRC32 instructions
+		 * @details They're optional in ARMv8.0, so we have to ask the kernel rather than just assuming they're there
+		 */
+		inline bool HasHardwareCRC32() {
+			static const bool hasCRC32 = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+			return hasCRC32;
+		}
+
+		__attribute__((target("crc")))
+		inline uint32_t HardwareCRC32(uint32_t crc, const uint8_t* data, size_t size) {
+			// The instructions dont invert the CRC before and after like zlib does, so we have to
+			crc = ~crc;
+
+			while (size > 0 && ((uintptr_t)data & 7) != 0) {
+				crc = __crc32b(crc, *data++);
+				size--;
+			}
+
+			while (size >= 32) {
+				uint64_t words[4];
+				memcpy(words, data, sizeof(words));
+
+				crc = __crc32d(crc, words[0]);
+				crc = __crc32d(crc, words[1]);
+				crc = __crc32d(crc, words[2]);
+				crc = __crc32d(crc, words[3]);
+
+				data += 32;
+				size -= 32;
+			}
+
+			while (size >= 8) {
+				uint64_t word;
+				memcpy(&word, data, sizeof(word));
+
+				crc = __crc32d(crc, word);
+				data += 8;
+				size -= 8;
+			}
+
+			while (size > 0) {
+				crc = __crc32b(crc, *data++);
+				size--;
+			}
+
+			return ~crc;
+		}
+#endif
+
+		/**
+		 * @brief Continues a CRC32 (the same one zip uses) over some more data
+		 * @details Uses the CPU's CRC32 instructions when there are some, and falls back to zlib otherwise
+		 *
+		 * @param crc The CRC32 of all the data before this chunk, or 0 to start a new one
+		 * @param data The data to add
+		 * @param size The size of the data
+		 * @return The updated CRC32
+		 */
+		inline uint32_t CRC32(uint32_t crc, const void* data, size_t size) {
+#if defined(__aarch64__)
+			if (HasHardwareCRC32()) return HardwareCRC32(crc, (const uint8_t*)data, size);
+#endif
+
+			const Bytef* bytes = (const Bytef*)data;
+
+			// zlib only takes 32 bit lengths
+			while (size > 0) {
+				uInt chunkSize = size > UINT32_MAX ? UINT32_MAX : (uInt)size;
+
+				crc = crc32(crc, bytes, chunkSize);
+				bytes += chunkSize;
+				size -= chunkSize;
+			}
+
+			return crc;
+		}
+
+		/**
+		 * An incremental SHA-256 hash, so data can be hashed as it arrives instead of all at once
+		 */
+		class SHA256 {
+		public:
+			SHA256() {
+				Reset();
+			}
+
+			/**
+			 * @brief Starts a new hash, forgetting everything added so far
+			 */
+			void Reset() {
+				static constexpr uint32_t initialState[8] = {
+					0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+				};
+
+				memcpy(m_State, initialState, sizeof(m_State));
+				m_BufferSize = 0;
+				m_TotalSize = 0;
+			}
+
+			/**
+			 * @brief Adds some more data to the hash
+			 *
+			 * @param data The data to add
+			 * @param size The size of the data
+			 */
+			void Update(const void* data, size_t size) {
+				const uint8_t* bytes = (const uint8_t*)data;
+				m_TotalSize += size;
+
+				// Finish off a block that was started by the last update
+				if (m_BufferSize > 0) {
+					size_t needed = std::min(size, sizeof(m_Buffer) - m_BufferSize);
+					memcpy(m_Buffer + m_BufferSize, bytes, needed);
+
+					m_BufferSize += needed;
+					bytes += needed;
+					size -= needed;
+
+					if (m_BufferSize < sizeof(m_Buffer)) return;
+
+					Transform(m_Buffer);
+					m_BufferSize = 0;
+				}
+
+				while (size >= sizeof(m_Buffer)) {
+					Transform(bytes);
+					bytes += sizeof(m_Buffer);
+					size -= sizeof(m_Buffer);
+				}
+
+				memcpy(m_Buffer, bytes, size);
+				m_BufferSize = size;
+			}
+
+			/**
+			 * @brief Gets the hash of everything added so far, as lower case hex
+			 * @details This doesnt change the hash, so more data can still be added afterwards
+			 */
+			std::string HexDigest() const {
+				SHA256 finished = *this;
+
+				// Pad with a 1 bit, then zeros up to 8 bytes before the end of a block, then the length in bits
+				uint64_t bitLength = m_TotalSize * 8;
+				uint8_t padding[72] = { 0x80 };
+				size_t paddingSize = (m_BufferSize < 56 ? 56 : 120) - m_BufferSize;
+
+				for (int i = 0; i < 8; i++) padding[paddingSize + i] = (uint8_t)(bitLength >> (56 - i * 8));
+				finished.Update(padding, paddingSize + 8);
+
+				char hex[65];
+				for (int i = 0; i < 8; i++) snprintf(hex + i * 8, 9, "%08x", finished.m_State[i]);
+
+				return std::string(hex, 64);
+			}
+
+		private:
+			static inline uint32_t RotateRight(uint32_t value, int count) {
+				return (value >> count) | (value << (32 - count));
+			}
+
+			void Transform(const uint8_t* block) {
+				static constexpr uint32_t roundConstants[64] = {
+					0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+					0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+					0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+					0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+					0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+					0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+					0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+					0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+				};
+
+				uint32_t schedule[64];
+
+				for (int i = 0; i < 16; i++) {
+					schedule[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+				}
+
+				for (int i = 16; i < 64; i++) {
+					uint32_t s0 = RotateRight(schedule[i - 15], 7) ^ RotateRight(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+					uint32_t s1 = RotateRight(schedule[i - 2], 17) ^ RotateRight(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+
+					schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+				}
+
+				uint32_t a = m_State[0], b = m_State[1], c = m_State[2], d = m_State[3];
+				uint32_t e = m_State[4], f = m_State[5], g = m_State[6], h = m_State[7];
+
+				for (int i = 0; i < 64; i++) {
+					uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+					uint32_t choice = (e & f) ^ (~e & g);
+					uint32_t temp1 = h + s1 + choice + roundConstants[i] + schedule[i];
+
+					uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+					uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+					uint32_t temp2 = s0 + majority;
+
+					h = g;
+					g = f;
+					f = e;
+					e = d + temp1;
+					d = c;
+					c = b;
+					b = a;
+					a = temp1 + temp2;
+				}
+
+				m_State[0] += a;
+				m_State[1] += b;
+				m_State[2] += c;
+				m_State[3] += d;
+				m_State[4] += e;
+				m_State[5] += f;
+				m_State[6] += g;
+				m_State[7] += h;
+			}
+
+			uint32_t m_State[8];
+			uint8_t m_Buffer[64];
+			size_t m_BufferSize;
+			uint64_t m_TotalSize;
+		};
+
+		/**
+		 * @brief Calculates the 64 bit FNV-1a hash of some data
+		 * @details Unlike std::hash, this is the same on every device and every run, so it can be used to name files
+		 *
+		 * @param data The data to hash
+		 * @param size The size of the data
+		 * @return The hash
+		 */
+		inline uint64_t FNV1a64(const void* data, size_t size) {
+			const uint8_t* bytes = (const uint8_t*)data;
+			uint64_t hash = 0xcbf29ce484222325ULL;
+
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ULL;
+			}
+
+			return hash;
+		}
+
+		/**
+		 * @brief Calculates the CRC32 of a file by reading the whole thing
+		 *
+		 * @param path The file to hash
+		 * @return The CRC32 of the file, or nullopt if it couldn't be read
+		 */
+		inline std::optional<uint32_t> CRC32File(std::string path) {
+			int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return std::nullopt;
+
+			// Big reads keep the number of syscalls down, but this is too big for the stack of a worker thread
+			constexpr size_t bufferSize = 256 * 1024;
+			std::unique_ptr<uint8_t[]> buffer(new uint8_t[bufferSize]);
+			uint32_t crc = 0;
+
+			while (true) {
+				ssize_t bytesRead = read(fd, buffer.get(), bufferSize);
+				if (bytesRead < 0 && errno == EINTR) continue;
+
+				if (bytesRead < 0) {
+					close(fd);
+					return std::nullopt;
+				}
+
+				if (bytesRead == 0) break;
+				crc = CRC32(crc, buffer.get(), bytesRead);
+			}
+
+			close(fd);
+			return crc;
+		}
+
+		/**
+		 * @brief Calculates the SHA-256 of a file by reading the whole thing
+		 *
+		 * @param path The file to hash
+		 * @return The SHA-256 of the file as lower case hex, or nullopt if it couldn't be read
+		 */
+		inline std::optional<std::string> SHA256File(std::string path) {
+			int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return std::nullopt;
+
+			constexpr size_t bufferSize = 256 * 1024;
+			std::unique_ptr<uint8_t[]> buffer(new uint8_t[bufferSize]);
+			SHA256 sha256;
+
+			while (true) {
+				ssize_t bytesRead = read(fd, buffer.get(), bufferSize);
+				if (bytesRead < 0 && errno == EINTR) continue;
+
+				if (bytesRead < 0) {
+					close(fd);
+					return std::nullopt;
+				}
+
+				if (bytesRead == 0) break;
+				sha256.Update(buffer.get(), bytesRead);
+			}
+
+			close(fd);
+			return sha256.HexDigest();
+		}
+
+		// Private shit dont use >:(
+
+		struct CachedFileCRC {
+			int64_t mtimeSec;
+			int64_t mtimeNsec;
+			int64_t size;
+			uint32_t crc;
+		};
+
+		inline std::mutex FileCRCCacheLock;
+		inline std::unordered_map<std::string, CachedFileCRC> FileCRCCache;
+
+		inline std::string GetFileCRCCacheKey(const struct stat& fileStat) {
+			return std::to_string(fileStat.st_dev) + ":" + std::to_string(fileStat.st_ino);
+		}
+
+		/**
+		 * @brief Remembers the CRC32 of a file that was just written, so it doesnt have to be read again later
+		 *
+		 * @param path The file that was written
+		 * @param crc The CRC32 of the file's contents
+		 */
+		inline void CacheFileCRC32(std::string path, uint32_t crc) {
+			struct stat fileStat;
+			if (stat(path.c_str(), &fileStat) != 0) return;
+
+			std::unique_lock guard(FileCRCCacheLock);
+			FileCRCCache[GetFileCRCCacheKey(fileStat)] = {fileStat.st_mtim.tv_sec, fileStat.st_mtim.tv_nsec, fileStat.st_size, crc};
+		}
+
+		/**
+		 * @brief Gets the CRC32 of a file, only reading it if it has changed since the last time it was hashed
+		 * @details Results are cached by inode, and are thrown away if the file's size or modification time changes
+		 *
+		 * @param path The file to hash
+		 * @return The CRC32 of the file, or nullopt if it doesnt exist or couldn't be read
+		 */
+		inline std::optional<uint32_t> GetFileCRC32(std::string path) {
+			struct stat fileStat;
+			if (stat(path.c_str(), &fileStat) != 0) return std::nullopt;
+
+			std::string key = GetFileCRCCacheKey(fileStat);
+
+			{
+				std::unique_lock guard(FileCRCCacheLock);
+
+				auto search = FileCRCCache.find(key);
+				if (search != FileCRCCache.end()) {
+					const CachedFileCRC& cached = search->second;
+					if (cached.mtimeSec == fileStat.st_mtim.tv_sec && cached.mtimeNsec == fileStat.st_mtim.tv_nsec && cached.size == fileStat.st_size) return cached.crc;
+				}
+			}
+
+			std::optional<uint32_t> crc = CRC32File(path);
+			if (!crc.has_value()) return std::nullopt;
+
+			std::unique_lock guard(FileCRCCacheLock);
+			FileCRCCache[key] = {fileStat.st_mtim.tv_sec, fileStat.st_mtim.tv_nsec, fileStat.st_size, *crc};
+
+			return crc;
+		}
+
+		/**
+		 * @brief Checks if a file already has specific contents, without reading it if the size alone rules it out
+		 *
+		 * @param path The file to check
+		 * @param size The expected size of the file
+		 * @param crc The expected CRC32 of the file
+		 * @return Returns true if the file exists and matches
+		 */
+		inline bool FileMatches(std::string path, uint64_t size, uint32_t crc) {
+			struct stat fileStat;
+			if (stat(path.c_str(), &fileStat) != 0 || (uint64_t)fileStat.st_size != size) return false;
+
+			std::optional<uint32_t> fileCRC = GetFileCRC32(path);
+			return fileCRC.has_value() && *fileCRC == crc;
+		}
+	}
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/document.h"
+#include "beatsaber-hook/shared/rapidjson/include/rapidjson/writer.h"
+
+#include "modloader-utils/shared/FileUtils.hpp"
+#include "modloader-utils/shared/HashUtils.hpp"
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace ModloaderUtils {
+	/**
+	 * An on disk cache of web responses, so that files and data which havent changed dont have to be downloaded again, even after a restart.
+	 * Each url gets a body file, and a json file with the ETag and Last-Modified date the server sent with it, which are sent back to the server to check if the cached copy is still current.
+	 * The json file's modification time is when the entry was last used, and the least recently used entries are removed once the cache grows past MaxCacheSize.
+	 * Downloaded files are only ever hard linked into the cache, never copied, so the cache sits on the same filesystem as the Temp/Downloads folder they're downloaded to
+	 */
+	namespace HttpCache {
+		// Where the cache is kept. It has to be on the same filesystem as the files being downloaded, and should only be changed before anything is downloaded
+		inline std::string CachePath = "/sdcard/BMBFData/ModloaderUtils/HttpCache/";
+
+		// How big the cache can get before the least recently used entries are removed
+		inline uint64_t MaxCacheSize = 256 * 1024 * 1024;
+
+		// Serve everything from the cache without asking the server if it has changed. Anything that isnt cached fails instead of being downloaded
+		inline bool OfflineMode = false;
+
+		// How long, in seconds, a cached file is trusted for after the server last said it was current, before the server is asked again
+		inline int64_t RevalidateInterval = 10 * 60;
+
+		struct CacheEntry {
+			std::string url;
+			std::string etag;
+			std::string lastModified;
+			uint64_t size = 0;
+
+			std::string bodyPath;
+			std::string metadataPath;
+
+			// Only known for files that were cached by DownloadFile. Empty otherwise
+			std::string sha256;
+			uint32_t crc32 = 0;
+
+			// When the server last sent this response, or said it was still current, in seconds since the epoch
+			int64_t validatedAt = 0;
+		};
+
+		// Private shit dont use >:(
+
+		inline std::mutex TrimLock;
+
+		inline std::string GetEntryPath(std::string url) {
+			char key[17];
+			snprintf(key, sizeof(key), "%016llx", (unsigned long long)HashUtils::FNV1a64(url.data(), url.size()));
+
+			return CachePath + key;
+		}
+
+		inline bool WriteMetadata(const CacheEntry& entry) {
+			rapidjson::StringBuffer buffer;
+			rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+			writer.StartObject();
+			writer.Key("url");
+			writer.String(entry.url.c_str());
+			writer.Key("etag");
+			writer.String(entry.etag.c_str());
+			writer.Key("lastModified");
+			writer.String(entry.lastModified.c_str());
+			writer.Key("size");
+			writer.Uint64(entry.size);
+
+			if (!entry.sha256.empty()) {
+				writer.Key("sha256");
+				writer.String(entry.sha256.c_str());
+				writer.Key("crc32");
+				writer.Uint(entry.crc32);
+			}
+
+			writer.Key("validatedAt");
+			writer.Int64(entry.validatedAt);
+
+			writer.EndObject();
+
+			FileUtils::AtomicFile file(entry.metadataPath);
+			return file.Write(buffer.GetString(), buffer.GetSize()) && file.Commit();
+		}
+
+		/**
+		 * @brief Removes the least recently used entries until the cache is no bigger than MaxCacheSize
+		 */
+		inline void Trim() {
+			std::unique_lock guard(TrimLock);
+
+			DIR* dir = opendir(CachePath.c_str());
+			if (dir == nullptr) return;
+
+			struct CachedFile {
+				std::string path;
+				uint64_t size;
+				struct timespec lastUsed;
+			};
+
+			std::vector<CachedFile> cachedFiles;
+			uint64_t totalSize = 0;
+
+			struct dirent* dp;
+			while ((dp = readdir(dir)) != nullptr) {
+				std::string name = dp->d_name;
+
+				// Skip anything that isnt an entry's metadata, including the hidden temp files entries are written to
+				if (name.starts_with(".") || !name.ends_with(".json")) continue;
+
+				std::string path = CachePath + name.substr(0, name.size() - 5);
+				struct stat metadataStat, bodyStat;
+
+				if (stat((path + ".json").c_str(), &metadataStat) != 0) continue;
+				uint64_t size = stat(path.c_str(), &bodyStat) == 0 ? bodyStat.st_size : 0;
+
+				cachedFiles.push_back({path, size, metadataStat.st_mtim});
+				totalSize += size;
+			}
+
+			closedir(dir);
+			if (totalSize <= MaxCacheSize) return;
+
+			std::sort(cachedFiles.begin(), cachedFiles.end(), [](const CachedFile& a, const CachedFile& b) {
+				return a.lastUsed.tv_sec != b.lastUsed.tv_sec ? a.lastUsed.tv_sec < b.lastUsed.tv_sec : a.lastUsed.tv_nsec < b.lastUsed.tv_nsec;
+			});
+
+			for (const CachedFile& cachedFile : cachedFiles) {
+				if (totalSize <= MaxCacheSize) break;
+
+				// Remove the metadata first, so a half removed entry never looks valid
+				unlink((cachedFile.path + ".json").c_str());
+				unlink(cachedFile.path.c_str());
+
+				totalSize -= cachedFile.size;
+			}
+		}
+
+		/**
+		 * @brief Finds the cached response for a url
+		 *
+		 * @param url The url that was requested
+		 * @return The cache entry, or nullopt if the url isnt cached
+		 */
+		inline std::optional<CacheEntry> Lookup(std::string url) {
+			CacheEntry entry;
+			entry.bodyPath = GetEntryPath(url);
+			entry.metadataPath = entry.bodyPath + ".json";
+
+			std::ifstream metadataFile(entry.metadataPath);
+			if (!metadataFile.good()) return std::nullopt;
+
+			std::stringstream metadataJson;
+			metadataJson << metadataFile.rdbuf();
+
+			rapidjson::Document document;
+			if (document.Parse(metadataJson.str().c_str()).HasParseError() || !document.IsObject()) return std::nullopt;
+
+			if (document.HasMember("url") && document["url"].IsString()) entry.url = document["url"].GetString();
+			if (document.HasMember("etag") && document["etag"].IsString()) entry.etag = document["etag"].GetString();
+			if (document.HasMember("lastModified") && document["lastModified"].IsString()) entry.lastModified = document["lastModified"].GetString();
+			if (document.HasMember("size") && document["size"].IsUint64()) entry.size = document["size"].GetUint64();
+			if (document.HasMember("sha256") && document["sha256"].IsString()) entry.sha256 = document["sha256"].GetString();
+			if (document.HasMember("crc32") && document["crc32"].IsUint()) entry.crc32 = document["crc32"].GetUint();
+			if (document.HasMember("validatedAt") && document["validatedAt"].IsInt64()) entry.validatedAt = document["validatedAt"].GetInt64();
+
+			// Different urls can end up with the same hash, and the body might have been removed by Trim
+			struct stat bodyStat;
+			if (entry.url != url || stat(entry.bodyPath.c_str(), &bodyStat) != 0 || (uint64_t)bodyStat.st_size != entry.size) return std::nullopt;
+
+			return entry;
+		}
+
+		/**
+		 * @brief Gets the headers that ask the server to only send a response if it has changed since it was cached
+		 * @details The server replies with a 304 and no body if the cached copy is still current
+		 *
+		 * @param entry The cached response
+		 * @return The headers to add to the request
+		 */
+		inline std::vector<std::string> GetRevalidationHeaders(const CacheEntry& entry) {
+			std::vector<std::string> headers;
+
+			if (!entry.etag.empty()) headers.push_back("If-None-Match: " + entry.etag);
+			if (!entry.lastModified.empty()) headers.push_back("If-Modified-Since: " + entry.lastModified);
+
+			return headers;
+		}
+
+		/**
+		 * @brief Checks if the server said an entry was current recently enough that it doesnt need asking again
+		 *
+		 * @param entry The cached response
+		 * @return Returns true if the entry was validated less than RevalidateInterval seconds ago
+		 */
+		inline bool IsFresh(const CacheEntry& entry) {
+			int64_t now = time(nullptr);
+			return entry.validatedAt <= now && now - entry.validatedAt < RevalidateInterval;
+		}
+
+		/**
+		 * @brief Records that the server just said an entry is still current
+		 *
+		 * @param entry The cached response, which is updated too
+		 */
+		inline void MarkValidated(CacheEntry& entry) {
+			entry.validatedAt = time(nullptr);
+			WriteMetadata(entry);
+		}
+
+		/**
+		 * @brief Marks an entry as just used, so it is one of the last to be removed when the cache is trimmed
+		 *
+		 * @param entry The cached response
+		 */
+		inline void Touch(const CacheEntry& entry) {
+			utimensat(AT_FDCWD, entry.metadataPath.c_str(), nullptr, 0);
+		}
+
+		/**
+		 * @brief Reads a cached response's body into memory
+		 *
+		 * @param entry The cached response
+		 * @return The body, or nullopt if it couldn't be read
+		 */
+		inline std::optional<std::string> ReadBody(const CacheEntry& entry) {
+			std::ifstream bodyFile(entry.bodyPath, std::ios::binary);
+			if (!bodyFile.good()) return std::nullopt;
+
+			std::string body(entry.size, '\0');
+			if (!bodyFile.read(body.data(), entry.size) || bodyFile.gcount() != (std::streamsize)entry.size) return std::nullopt;
+
+			return body;
+		}
+
+		/**
+		 * @brief Puts a copy of a cached response's body somewhere else
+		 * @details The body is hard linked if possible, so nothing has to be copied
+		 *
+		 * @param entry The cached response
+		 * @param destination Where to put the body
+		 * @return Returns true if the destination now holds the body
+		 */
+		inline bool CopyBody(const CacheEntry& entry, std::string destination) {
+			return FileUtils::LinkOrCopy(entry.bodyPath, destination);
+		}
+
+		/**
+		 * @brief Caches a response that is in memory
+		 *
+		 * @param url The url that was requested
+		 * @param etag The ETag header the server sent, if any
+		 * @param lastModified The Last-Modified header the server sent, if any
+		 * @param body The body of the response
+		 * @return Returns true if the response was cached
+		 */
+		inline bool Store(std::string url, std::string etag, std::string lastModified, const std::string& body) {
+			if (body.size() > MaxCacheSize) return false;
+
+			CacheEntry entry{url, etag, lastModified, body.size(), GetEntryPath(url), GetEntryPath(url) + ".json", "", 0, time(nullptr)};
+
+			// The old metadata goes first, and the new metadata last, so the entry is never valid with the wrong body
+			unlink(entry.metadataPath.c_str());
+
+			FileUtils::AtomicFile bodyFile(entry.bodyPath);
+			if (!bodyFile.Write(body.data(), body.size()) || !bodyFile.Commit() || !WriteMetadata(entry)) return false;
+
+			Trim();
+			return true;
+		}
+
+		/**
+		 * @brief Caches a response that was downloaded to a file
+		 *
+		 * @param url The url that was requested
+		 * @param etag The ETag header the server sent, if any
+		 * @param lastModified The Last-Modified header the server sent, if any
+		 * @param path The file the body was downloaded to. It is hard linked into the cache, so it should never be modified in place afterwards
+		 * @param sha256 The SHA-256 of the file as lower case hex, if it is known
+		 * @param crc32 The CRC32 of the file, if the SHA-256 is known
+		 * @return Returns true if the response was cached. If the filesystem doesnt support hard links, the file isnt cached, as copying it would double what gets written for every download
+		 */
+		inline bool StoreFile(std::string url, std::string etag, std::string lastModified, std::string path, std::string sha256 = "", uint32_t crc32 = 0) {
+			struct stat fileStat;
+			if (stat(path.c_str(), &fileStat) != 0 || (uint64_t)fileStat.st_size > MaxCacheSize) return false;
+
+			CacheEntry entry{url, etag, lastModified, (uint64_t)fileStat.st_size, GetEntryPath(url), GetEntryPath(url) + ".json", sha256, crc32, time(nullptr)};
+
+			// Theres no point relinking the body if its already the one in the cache
+			struct stat bodyStat;
+			bool alreadyCached = stat(entry.bodyPath.c_str(), &bodyStat) == 0 && bodyStat.st_dev == fileStat.st_dev && bodyStat.st_ino == fileStat.st_ino;
+
+			unlink(entry.metadataPath.c_str());
+
+			if (!alreadyCached) {
+				// link() wont replace an existing file
+				if (!FileUtils::MakeDirs(CachePath) || (unlink(entry.bodyPath.c_str()) != 0 && errno != ENOENT)) return false;
+				if (link(path.c_str(), entry.bodyPath.c_str()) != 0) return false;
+			}
+
+			if (!WriteMetadata(entry)) return false;
+
+			Trim();
+			return true;
+		}
+
+		/**
+		 * @brief Removes a url's cached response
+		 *
+		 * @param url The url that was requested
+		 */
+		inline void Remove(std::string url) {
+			std::string path = GetEntryPath(url);
+
+			unlink((path + ".json").c_str());
+			unlink(path.c_str());
+		}
+	}
+}
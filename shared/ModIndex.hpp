@@ -0,0 +1,316 @@
+#pragma once
+
+#include "modloader-utils/shared/Types/StringHash.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <optional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace ModloaderUtils {
+	/**
+	 * An in memory index of the mod files in the mods and libs folders, so looking up a mod doesnt mean listing both folders again.
+	 * The folders are scanned once, and after that single files are updated as they change, either by this library or by ModWatcher noticing another app change them.
+	 * The folders are only scanned again after Invalidate has been called
+	 */
+	namespace ModIndex {
+		inline const std::string ModsPath = "/sdcard/Android/data/com.beatgames.beatsaber/files/mods/";
+		inline const std::string LibsPath = "/sdcard/Android/data/com.beatgames.beatsaber/files/libs/";
+
+		struct IndexEntry {
+			// libmodname.so / libmodname.disabled
+			std::string fileName;
+
+			// libmodname
+			std::string libName;
+
+			// True if the file is in the libs folder, false if its in the mods folder
+			bool library = false;
+
+			// True for .so files, false for .disabled files
+			bool enabled = false;
+
+			// True if the file name doesnt start with "lib"
+			bool oddLib = false;
+
+			const inline std::string Path() const { return (library ? LibsPath : ModsPath) + fileName; }
+		};
+
+		// Private shit dont use >:(
+
+		inline std::mutex IndexLock;
+		inline std::atomic<bool> Stale = true;
+		inline std::atomic<uint64_t> Generation = 0;
+
+		// Keyed by file name
+		inline StringMap<IndexEntry> Entries;
+
+		// Lib name and stem (the lib name without "lib" on the front) to file name. Enabled files win if a mod has both a .so and a .disabled file
+		inline StringMap<std::string> LibNames;
+		inline StringMap<std::string> Stems;
+
+		inline StringSet OddLibNames;
+
+		// Builds an entry for a file name, or returns nullopt if the file isnt a mod
+		inline std::optional<IndexEntry> MakeEntry(std::string fileName, bool library) {
+			IndexEntry entry;
+			entry.fileName = fileName;
+			entry.library = library;
+
+			if (fileName.size() > 3 && fileName.ends_with(".so")) {
+				entry.enabled = true;
+				entry.libName = fileName.substr(0, fileName.size() - 3);
+			} else if (fileName.size() > 9 && fileName.ends_with(".disabled")) {
+				entry.enabled = false;
+				entry.libName = fileName.substr(0, fileName.size() - 9);
+			} else {
+				return std::nullopt;
+			}
+
+			entry.oddLib = !entry.libName.starts_with("lib");
+			return entry;
+		}
+
+		// Must be called with IndexLock held
+		inline void AddNames(const IndexEntry& entry) {
+			auto AddName = [&](StringMap<std::string>& names, std::string name) {
+				auto nameSearch = names.find(name);
+				if (nameSearch == names.end() || (entry.enabled && !Entries.at(nameSearch->second).enabled)) names[name] = entry.fileName;
+			};
+
+			AddName(LibNames, entry.libName);
+			if (entry.libName.starts_with("lib")) AddName(Stems, entry.libName.substr(3));
+
+			if (entry.oddLib) OddLibNames.insert(entry.libName);
+		}
+
+		// Must be called with IndexLock held
+		inline void AddEntry(const IndexEntry& entry) {
+			auto search = Entries.find(entry.fileName);
+
+			// The mods folder wins if the same file is in both folders, as thats the order the folders used to be searched in
+			if (search != Entries.end() && !search->second.library && entry.library) return;
+			Entries[entry.fileName] = entry;
+
+			AddNames(entry);
+		}
+
+		// Must be called with IndexLock held
+		inline void RemoveEntry(const std::string& fileName) {
+			auto search = Entries.find(fileName);
+			if (search == Entries.end()) return;
+
+			std::string libName = search->second.libName;
+			Entries.erase(search);
+
+			// The other file for the same mod (the .so for a .disabled, or the other way round) takes over the names, if there is one
+			LibNames.erase(libName);
+			if (libName.starts_with("lib")) Stems.erase(libName.substr(3));
+			OddLibNames.erase(libName);
+
+			for (std::string otherFileName : { libName + ".so", libName + ".disabled" }) {
+				auto otherSearch = Entries.find(otherFileName);
+				if (otherSearch != Entries.end()) AddNames(otherSearch->second);
+			}
+		}
+
+		// Must be called with IndexLock held
+		inline void ScanDir(std::string path, bool library) {
+			DIR* dir = opendir(path.c_str());
+			if (dir == nullptr) return;
+
+			dirent* dp;
+			while ((dp = readdir(dir)) != nullptr) {
+				if (dp->d_type == DT_DIR) continue;
+
+				std::optional<IndexEntry> entry = MakeEntry(dp->d_name, library);
+				if (entry.has_value()) AddEntry(*entry);
+			}
+
+			closedir(dir);
+		}
+
+		// Must be called with IndexLock held
+		inline void Refresh() {
+			if (!Stale.exchange(false)) return;
+
+			Entries.clear();
+			LibNames.clear();
+			Stems.clear();
+			OddLibNames.clear();
+
+			ScanDir(ModsPath, false);
+			ScanDir(LibsPath, true);
+		}
+
+		// Must be called with IndexLock held
+		inline std::optional<IndexEntry> FindFile(const StringMap<std::string>& names, std::string_view name) {
+			auto search = names.find(name);
+			if (search == names.end()) return std::nullopt;
+
+			return Entries.at(search->second);
+		}
+
+		/**
+		 * @brief Marks the index as out of date, so the folders are scanned again the next time the index is used
+		 * @details Call this after changing the mods or libs folder without going through this library
+		 */
+		inline void Invalidate() {
+			Stale = true;
+			Generation++;
+		}
+
+		/**
+		 * @brief Gets a number which changes every time the index does
+		 * @details Anything worked out from the index can be kept until this changes
+		 *
+		 * @return The index's generation
+		 */
+		inline uint64_t GetGeneration() {
+			return Generation;
+		}
+
+		/**
+		 * @brief Updates the index for a single file, after it has been added, removed or renamed
+		 * @details The file is checked on disk, so this is safe to call more than once for the same change, or for files that arent mods
+		 *
+		 * @param fileName The name of the file that changed
+		 * @param library True if the file is in the libs folder, false if its in the mods folder
+		 */
+		inline void Update(std::string fileName, bool library) {
+			std::unique_lock guard(IndexLock);
+
+			// The next lookup scans everything anyway
+			if (Stale) return;
+
+			std::optional<IndexEntry> entry = MakeEntry(fileName, library);
+			if (!entry.has_value()) return;
+
+			// The same file in both folders is rare enough that its not worth working out which one should win
+			auto search = Entries.find(fileName);
+			if (search != Entries.end() && search->second.library != library) {
+				Invalidate();
+				return;
+			}
+
+			struct stat fileStat;
+			bool exists = stat(entry->Path().c_str(), &fileStat) == 0 && !S_ISDIR(fileStat.st_mode);
+			if (exists == (search != Entries.end())) return;
+
+			if (exists) AddEntry(*entry);
+			else RemoveEntry(fileName);
+
+			Generation++;
+		}
+
+		/**
+		 * @brief Finds a mod file by its file name
+		 *
+		 * @param fileName The file name, for example "libmodname.so"
+		 * @return The file's entry, or nullopt if the file isnt in either folder
+		 */
+		inline std::optional<IndexEntry> FindByFileName(std::string_view fileName) {
+			std::unique_lock guard(IndexLock);
+			Refresh();
+
+			auto search = Entries.find(fileName);
+			if (search == Entries.end()) return std::nullopt;
+
+			return search->second;
+		}
+
+		/**
+		 * @brief Finds a mod file by its lib name
+		 * @details If the mod has both a .so and a .disabled file, the .so file is returned
+		 *
+		 * @param libName The lib name, for example "libmodname"
+		 * @return The file's entry, or nullopt if neither folder has a file with that lib name
+		 */
+		inline std::optional<IndexEntry> FindByLibName(std::string_view libName) {
+			std::unique_lock guard(IndexLock);
+			Refresh();
+
+			return FindFile(LibNames, libName);
+		}
+
+		/**
+		 * @brief Finds a mod file by its lib name without "lib" on the front
+		 * @details If the mod has both a .so and a .disabled file, the .so file is returned
+		 *
+		 * @param stem The stem, for example "modname" for "libmodname.so"
+		 * @return The file's entry, or nullopt if neither folder has a file with that stem
+		 */
+		inline std::optional<IndexEntry> FindByStem(std::string_view stem) {
+			std::unique_lock guard(IndexLock);
+			Refresh();
+
+			return FindFile(Stems, stem);
+		}
+
+		/**
+		 * @brief Checks if a mod file is in the libs folder
+		 * @details Unlike FindByFileName, nothing is copied
+		 *
+		 * @param fileName The file name, for example "libmodname.so"
+		 * @return Returns true if the file is in the libs folder, and false if its in the mods folder or isnt in either
+		 */
+		inline bool IsLibraryFile(std::string_view fileName) {
+			std::unique_lock guard(IndexLock);
+			Refresh();
+
+			auto search = Entries.find(fileName);
+			return search != Entries.end() && search->second.library;
+		}
+
+		/**
+		 * @brief Gets every mod file in the mods and libs folders
+		 *
+		 * @return A copy of every entry in the index
+		 */
+		inline std::vector<IndexEntry> GetEntries() {
+			std::unique_lock guard(IndexLock);
+			Refresh();
+
+			std::vector<IndexEntry> entries;
+			entries.reserve(Entries.size());
+
+			for (const std::pair<const std::string, IndexEntry>& entryPair : Entries) {
+				entries.push_back(entryPair.second);
+			}
+
+			return entries;
+		}
+
+		/**
+		 * @brief Checks if a lib name belongs to a mod file that doesnt start with "lib"
+		 *
+		 * @param libName The lib name to check
+		 * @return Returns true if the lib name is an odd lib
+		 */
+		inline bool IsOddLibName(std::string_view libName) {
+			std::unique_lock guard(IndexLock);
+			Refresh();
+
+			return OddLibNames.contains(libName);
+		}
+
+		/**
+		 * @brief Gets the lib names of every mod file that doesnt start with "lib"
+		 *
+		 * @return A list of odd lib names
+		 */
+		inline std::list<std::string> GetOddLibNames() {
+			std::unique_lock guard(IndexLock);
+			Refresh();
+
+			return std::list<std::string>(OddLibNames.begin(), OddLibNames.end());
+		}
+	}
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "modloader-utils/shared/ModIndex.hpp"
+
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/inotify.h>
+
+namespace ModloaderUtils {
+	/**
+	 * Watches the mods, libs and QMods folders with inotify, so changes made by BMBF or any other app are noticed without rescanning anything.
+	 * Changes to the mods and libs folders are applied to ModIndex one file at a time as they happen. If the kernel drops events because too many happened at once,
+	 * ModIndex is rescanned instead. Anything else that keeps state about these folders can subscribe to be told about changes
+	 */
+	namespace ModWatcher {
+		inline const std::string QModsPath = "/sdcard/BMBFData/Mods/";
+
+		enum class WatchedFolder {
+			Mods,
+			Libs,
+			QMods
+		};
+
+		enum class ChangeType {
+			// A file was created, or moved into the folder
+			Added,
+
+			// A file was deleted, or moved out of the folder
+			Removed,
+
+			// A file that was open for writing was closed, so it should be complete now
+			Written,
+
+			// Events were dropped, so anything could have changed. fileName is empty
+			Rescanned
+		};
+
+		struct FolderChange {
+			WatchedFolder folder;
+			ChangeType type;
+			std::string fileName;
+		};
+
+		// Private shit dont use >:(
+
+		inline std::atomic<bool> Started = false;
+		inline std::atomic<bool> Running = false;
+
+		inline std::mutex SubscribersLock;
+		inline std::map<size_t, std::function<void(const FolderChange& change)>> Subscribers;
+		inline size_t NextSubscriberId = 0;
+
+		inline void Publish(const FolderChange& change) {
+			// Copied so subscribers can subscribe and unsubscribe from inside their callbacks
+			std::map<size_t, std::function<void(const FolderChange& change)>> subscribers;
+
+			{
+				std::unique_lock guard(SubscribersLock);
+				subscribers = Subscribers;
+			}
+
+			for (const std::pair<const size_t, std::function<void(const FolderChange& change)>>& subscriber : subscribers) {
+				subscriber.second(change);
+			}
+		}
+
+		inline void HandleEvent(const inotify_event* event, const std::unordered_map<int, WatchedFolder>& folders) {
+			if (event->mask & IN_Q_OVERFLOW) {
+				ModIndex::Invalidate();
+
+				for (WatchedFolder folder : { WatchedFolder::Mods, WatchedFolder::Libs, WatchedFolder::QMods }) {
+					Publish({folder, ChangeType::Rescanned, ""});
+				}
+
+				return;
+			}
+
+			auto search = folders.find(event->wd);
+			if (search == folders.end() || event->len == 0 || (event->mask & IN_ISDIR)) return;
+
+			WatchedFolder folder = search->second;
+			std::string fileName = event->name;
+
+			ChangeType type;
+			if (event->mask & (IN_CREATE | IN_MOVED_TO)) type = ChangeType::Added;
+			else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) type = ChangeType::Removed;
+			else if (event->mask & IN_CLOSE_WRITE) type = ChangeType::Written;
+			else return;
+
+			if (folder != WatchedFolder::QMods && type != ChangeType::Written) ModIndex::Update(fileName, folder == WatchedFolder::Libs);
+
+			Publish({folder, type, fileName});
+		}
+
+		inline void Run(int fd, std::unordered_map<int, WatchedFolder> folders) {
+			// Big enough for plenty of events at once, and aligned the same as inotify_event
+			alignas(inotify_event) char buffer[16 * 1024];
+
+			while (true) {
+				ssize_t length = read(fd, buffer, sizeof(buffer));
+				if (length < 0) {
+					if (errno == EINTR) continue;
+					break;
+				}
+
+				for (char* ptr = buffer; ptr < buffer + length; ) {
+					const inotify_event* event = (const inotify_event*)ptr;
+					HandleEvent(event, folders);
+
+					ptr += sizeof(inotify_event) + event->len;
+				}
+			}
+
+			// If we ever stop, nothing can be trusted to be up to date anymore
+			Running = false;
+			ModIndex::Invalidate();
+			close(fd);
+		}
+
+		/**
+		 * @brief Starts watching the folders, if they arent being watched already
+		 * @details The watcher runs on its own thread for the lifetime of the process
+		 *
+		 * @return Returns true if the folders are being watched
+		 */
+		inline bool Start() {
+			if (Started.exchange(true)) return Running;
+
+			int fd = inotify_init1(IN_CLOEXEC);
+			if (fd < 0) return false;
+
+			uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE;
+			std::unordered_map<int, WatchedFolder> folders;
+
+			auto Watch = [&](std::string path, WatchedFolder folder) {
+				int wd = inotify_add_watch(fd, path.c_str(), mask);
+				if (wd >= 0) folders[wd] = folder;
+			};
+
+			Watch(ModIndex::ModsPath, WatchedFolder::Mods);
+			Watch(ModIndex::LibsPath, WatchedFolder::Libs);
+			Watch(QModsPath, WatchedFolder::QMods);
+
+			if (folders.empty()) {
+				close(fd);
+				return false;
+			}
+
+			// Anything that changed before the watches were added would have been missed
+			ModIndex::Invalidate();
+
+			Running = true;
+			std::thread(Run, fd, std::move(folders)).detach();
+
+			return true;
+		}
+
+		/**
+		 * @brief Checks if the folders are being watched
+		 *
+		 * @return Returns true if the watcher is running
+		 */
+		inline bool IsRunning() {
+			return Running;
+		}
+
+		/**
+		 * @brief Gets told about every change to the watched folders
+		 * @details The callback runs on the watcher thread, so it should be quick. ModIndex has already been updated by the time it is called
+		 *
+		 * @param callback Called with each change
+		 * @return An id that can be passed to Unsubscribe
+		 */
+		inline size_t Subscribe(std::function<void(const FolderChange& change)> callback) {
+			std::unique_lock guard(SubscribersLock);
+
+			size_t id = NextSubscriberId++;
+			Subscribers[id] = std::move(callback);
+
+			return id;
+		}
+
+		/**
+		 * @brief Stops being told about changes
+		 * @details The callback may still be called once more if a change is being published right now
+		 *
+		 * @param id The id returned by Subscribe
+		 */
+		inline void Unsubscribe(size_t id) {
+			std::unique_lock guard(SubscribersLock);
+			Subscribers.erase(id);
+		}
+	}
+}
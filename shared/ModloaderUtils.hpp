@@ -1,6 +1,14 @@
 #pragma once
 
 #include "modloader-utils/shared/Types/QMod.hpp"
+#include "modloader-utils/shared/Types/QModView.hpp"
+#include "modloader-utils/shared/Types/IntegrityReport.hpp"
+#include "modloader-utils/shared/Types/StringHash.hpp"
+#include "modloader-utils/shared/ThreadUtils.hpp"
+#include "modloader-utils/shared/HashUtils.hpp"
+#include "modloader-utils/shared/ZipUtils.hpp"
+#include "modloader-utils/shared/ModIndex.hpp"
+#include "modloader-utils/shared/ModWatcher.hpp"
 
 #include "modloader/shared/modloader.hpp"
 
@@ -9,11 +17,16 @@
 #include "jni-utils/shared/JNIUtils.hpp"
 
 #include <list>
+#include <string_view>
 #include <dirent.h>
 #include <jni.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <sstream>
 #include <fstream>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 Logger& getLogger();
 
@@ -29,11 +42,17 @@ namespace ModloaderUtils {
 	inline std::string m_GameVersion;
 	inline std::string m_PackageName;
  
-	inline std::list<std::string>* m_OddLibNames;
-	inline std::list<std::string>* m_CoreMods;
-	inline std::list<std::string>* m_LoadedMods;
+	inline StringSet* m_CoreMods;
+	inline StringSet* m_LoadedMods;
  
-	inline std::unordered_map<std::string, std::string>* m_ModVersions;
+	inline StringMap<std::string>* m_ModVersions;
+
+	struct ResolvedName {
+		std::string libName;
+
+		// "Null" if the mod doesnt have a file in the mods or libs folder
+		std::string fileName;
+	};
 
 	/**
 	 * @brief Get all the files that are contained in a specified directory
@@ -45,13 +64,17 @@ namespace ModloaderUtils {
 
 	/**
 	 * @brief Get all of the QMods that are currently downloaded
+	 * @details This is a snapshot which is never modified, so it can be read from any thread, and kept for as long as it's needed.
+	 * QMods downloaded or removed afterwards only show up the next time this is called
 	 * 
 	 * @return A List of all downloaded QMods 
 	 */
-	inline std::unordered_map<std::string, ModloaderUtils::QMod *>* GetDownloadedQMods();
+	inline std::shared_ptr<const std::unordered_map<std::string, ModloaderUtils::QMod *>> GetDownloadedQMods();
 
 	/**
 	 * @brief Get all of the QMods that are currently installed
+	 * @details A new map is allocated on every call, and the caller owns it, so it has to be deleted once it's done with.
+	 * Prefer ViewQMods with a filter, which doesn't allocate anything
 	 * 
 	 * @return A List of all installed QMods 
 	 */
@@ -59,18 +82,50 @@ namespace ModloaderUtils {
 
 	/**
 	 * @brief Get all of the QMods that are currently uninstalled
+	 * @details A new map is allocated on every call, and the caller owns it, so it has to be deleted once it's done with.
+	 * Prefer ViewQMods with a filter, which doesn't allocate anything
 	 * 
 	 * @return A List of all uninstalled QMods 
 	 */
 	inline std::unordered_map<std::string, ModloaderUtils::QMod *>* GetUninstalledQMods();
 
+	/**
+	 * @brief Get a view of the downloaded QMods that match a filter, without copying or allocating anything
+	 * @details The QMods are filtered as the view is iterated, so the view always reflects their current state.
+	 * The view holds a snapshot of the downloaded QMods, so it's safe to keep, but QMods downloaded or removed after it was made won't be in it
+	 * 
+	 * @param filter Which QMods to include. Includes every QMod by default
+	 * @return A view that can be used in a range based for loop
+	 */
+	inline QModView ViewQMods(QModFilter filter = {});
+
+	/**
+	 * @brief Calls a function for every downloaded QMod that matches a filter, without copying or allocating anything
+	 * 
+	 * @param filter Which QMods to visit
+	 * @param visitor Called as `visitor(QMod* qmod)`
+	 */
+	template<typename Visitor>
+	inline void ForEachQMod(QModFilter filter, Visitor&& visitor);
+
+	/**
+	 * @brief Finds the downloaded QMods where a field matches a value, using an index rather than looking at every QMod
+	 * @details For example, `FindQMods(QModField::Author, "Bobby")` finds every QMod by Bobby, and `FindQMods(QModField::LibraryFile, "libcustom-types", true)` finds every QMod that ships a version of custom types
+	 * 
+	 * @param field Which field to search
+	 * @param value The value to look for
+	 * @param prefix If true, matches QMods where the field starts with the value, rather than being exactly the value
+	 * @return The matching QMods, each included once
+	 */
+	inline std::vector<QMod*> FindQMods(QModField field, std::string_view value, bool prefix = false);
+
 	/**
 	 * @brief Sets the activity of a specific mod
 	 * 
 	 * @param name The mod to enable or disable
 	 * @param active Whether to enable or disable the mod
 	 */
-	inline void SetModActive(std::string name, bool active);
+	inline void SetModActive(std::string_view name, bool active);
 
 	/**
 	 * @brief Sets the activity of a list of mods
@@ -85,7 +140,7 @@ namespace ModloaderUtils {
 	 * 
 	 * @param name The mod to toggle
 	 */
-	inline void ToggleMod(std::string name);
+	inline void ToggleMod(std::string_view name);
 
 	/**
 	 * @brief Toggles a list of mods on or off
@@ -130,7 +185,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to check
 	 * @return Returns true if disabled
 	 */
-	inline bool IsDisabled(std::string name);
+	inline bool IsDisabled(std::string_view name);
 
 	/**
 	 * @brief Checks if a mod is an odd lib or not
@@ -140,7 +195,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to check
 	 * @return Returns true if mod is an odd lib
 	 */
-	inline bool IsOddLibName(std::string name);
+	inline bool IsOddLibName(std::string_view name);
 
 	/**
 	 * @brief Checks if a mod is loaded
@@ -149,7 +204,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to check
 	 * @return Returns true if the mod is loaded
 	 */
-	inline bool IsModLoaded(std::string name);
+	inline bool IsModLoaded(std::string_view name);
 
 	/**
 	 * @brief Checks if a mod is a core mod
@@ -157,7 +212,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to check
 	 * @return Returns true if the mod is a core mod
 	 */
-	inline bool IsCoreMod(std::string name);
+	inline bool IsCoreMod(std::string_view name);
 
 	/**
 	 * @brief Checks if a mod is a "Library" file or a "Mod" file
@@ -166,7 +221,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to check
 	 * @return Returns true if the mod is a "Library" File. Returns false if the mod is a "Mod" File
 	 */
-	inline bool IsModALibrary(std::string name);
+	inline bool IsModALibrary(std::string_view name);
 
     // Mod Id = Mod Name
     // Lib Name = libmodname
@@ -182,7 +237,7 @@ namespace ModloaderUtils {
 	 * @param name The name to check
 	 * @return Returns true if the name is a Mod ID
 	 */
-    inline bool IsModID(std::string name);
+    inline bool IsModID(std::string_view name);
 
 	/**
 	 * @brief Checks if a mod name is a Lib Name
@@ -190,7 +245,7 @@ namespace ModloaderUtils {
 	 * @param name The name to check
 	 * @return Returns true if the name is a Lib Name
 	 */
-    inline bool IsLibName(std::string name);
+    inline bool IsLibName(std::string_view name);
 
 	/**
 	 * @brief Checks if a mod name is a File Name
@@ -198,7 +253,7 @@ namespace ModloaderUtils {
 	 * @param name The name to check
 	 * @return Returns true if the name is a File Name
 	 */
-    inline bool IsFileName(std::string name);
+    inline bool IsFileName(std::string_view name);
 
     // Name Conversions
 
@@ -209,7 +264,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to get the id of
 	 * @return The mod's Mod ID. If the mod isn't loaded or the mod is a lib, the mod's Lib Name will be returned instead
 	 */
-	inline std::string GetModID(std::string name);
+	inline std::string GetModID(std::string_view name);
 
 	/**
 	 * @brief Gets the Lib Name of a mod
@@ -218,7 +273,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to get the lib name of
 	 * @return The mod's Lib Name.
 	 */
-    inline std::string GetLibName(std::string name);
+    inline std::string GetLibName(std::string_view name);
 
 	/**
 	 * @brief Gets the File Name of a mod
@@ -227,7 +282,7 @@ namespace ModloaderUtils {
 	 * @param name The mod to get the file name of
 	 * @return The mod's File Name.
 	 */
-    inline std::string GetFileName(std::string name);
+    inline std::string GetFileName(std::string_view name);
 
 	/**
 	 * @brief Gets the Version of a loaded mod
@@ -235,7 +290,16 @@ namespace ModloaderUtils {
 	 * @param name The mod to get the version of
 	 * @return The mod's version. Returns "Unknown" if failed to get the mod version
 	 */
-    inline std::string GetModVersion(std::string name);
+    inline std::string GetModVersion(std::string_view name);
+
+	/**
+	 * @brief Gets the Lib Name and File Name of a mod without copying them
+	 * @details The names are borrowed from a cache, which the returned pointer keeps alive, so they stay valid even after the mod folders change
+	 * 
+	 * @param name The mod to get the names of
+	 * @return The mod's names, or nullptr if there isnt a mod with that name
+	 */
+	inline std::shared_ptr<const ResolvedName> FindModNames(std::string_view name);
 
 	/**
 	 * @brief Get a list of all the loaded mods
@@ -265,7 +329,7 @@ namespace ModloaderUtils {
 	 * @param name The name of the mod to test for an error
 	 * @return Returns the error if there was one, else returns null
 	 */
-	inline std::optional<std::string> GetModError(std::string name);
+	inline std::optional<std::string> GetModError(std::string_view name);
 
 	/**
 	 * @brief Gets the location of the Mods folder
@@ -308,6 +372,22 @@ namespace ModloaderUtils {
 	 */
 	inline bool RemoveDuplicateMods();
 
+	/**
+	 * @brief Checks that the files installed by every installed QMod still match what's in the QMod
+	 * @details Every installed file is hashed across all cores and compared against the CRC32 stored in its QMod.
+	 * This reads every installed file, so dont call it on the main thread
+	 * 
+	 * @return A report of the missing and modified files for each installed QMod, along with any files that no QMod installed
+	 */
+	inline IntegrityReport ScanInstalledQMods();
+
+	/**
+	 * @brief Reloads the list of mods that Modloader has loaded
+	 * @details Modloader's mods are only read once, when ModloaderUtils is initialized, as reading them copies every mod.
+	 * Only call this if something was loaded after that, for example if ModloaderUtils was used while Modloader was still loading mods
+	 */
+	inline void RefreshLoadedMods();
+
 	// Private shit dont use >:(
 
 	inline void Init();
@@ -316,7 +396,6 @@ namespace ModloaderUtils {
 	inline void CollectCoreMods();
 	inline void CollectLoadedMods();
 	inline void CollectModVersions();
-	inline void CollectOddLibs();
 	inline void CollectGameVersion();
 	inline void CollectPackageName();
 	inline void CollectDownloadedQMods();
@@ -324,6 +403,41 @@ namespace ModloaderUtils {
 	inline std::string GetFileNameFromDir(std::string libName, bool guessLibName = false);
 	inline std::string GetFileNameFromModID(std::string modID);
 
+	struct NameTable {
+		// The ModIndex generation the table was built from
+		uint64_t generation;
+
+		// The LoadedModsSnapshot generation the table was built from
+		uint64_t modsGeneration;
+
+		// Keyed by every File Name, Lib Name, Lib Name without "lib" on the front and Mod ID that there's a mod for
+		StringMap<ResolvedName> names;
+	};
+
+	// Never modified once its built, so readers can keep using an old table while a new one is swapped in
+	inline std::shared_ptr<const NameTable> m_NameTable;
+
+	inline std::shared_ptr<const NameTable> GetNameTable();
+
+	struct LoadedModsSnapshot {
+		// Goes up every time the snapshot is rebuilt
+		uint64_t generation;
+
+		// Keyed by Mod ID
+		StringMap<const Mod> mods;
+
+		// File Name to Mod ID
+		StringMap<std::string> ids;
+	};
+
+	// Never modified once its built, same as m_NameTable
+	inline std::shared_ptr<const LoadedModsSnapshot> m_LoadedModsSnapshot;
+
+	inline std::shared_ptr<const LoadedModsSnapshot> GetLoadedModsSnapshot();
+	inline ResolvedName ResolveName(std::string name);
+	inline std::string StripExtension(std::string_view fileName);
+	inline std::string_view GetFileNameView(std::string_view name, std::shared_ptr<const ResolvedName>& names);
+
 	// Definitions
 
 	std::list<std::string> GetDirContents(std::string dirPath) {
@@ -342,17 +456,19 @@ namespace ModloaderUtils {
 		return files;
 	}
 
-	std::unordered_map<std::string, ModloaderUtils::QMod *>* GetDownloadedQMods() {
+	std::shared_ptr<const std::unordered_map<std::string, ModloaderUtils::QMod *>> GetDownloadedQMods() {
 		Init();
 
-		return QMod::DownloadedQMods;
+		return QMod::GetDownloadedQMods();
 	}
 
 	std::unordered_map<std::string, ModloaderUtils::QMod *>* GetInstalledQMods() {
 		Init();
 
+		std::shared_ptr<const QMod::QModMap> downloadedQMods = QMod::GetDownloadedQMods();
+
 		std::unordered_map<std::string, ModloaderUtils::QMod *>* installedQMods = new std::unordered_map<std::string, ModloaderUtils::QMod *>();
-		for (std::pair<std::string, QMod*> qmodPair : *QMod::DownloadedQMods) {
+		for (const std::pair<const std::string, QMod*>& qmodPair : *downloadedQMods) {
 			if (qmodPair.second->Installed()) installedQMods->insert(qmodPair);
 		}
 
@@ -362,50 +478,66 @@ namespace ModloaderUtils {
 	std::unordered_map<std::string, ModloaderUtils::QMod *>* GetUninstalledQMods() {
 		Init();
 
+		std::shared_ptr<const QMod::QModMap> downloadedQMods = QMod::GetDownloadedQMods();
+
 		std::unordered_map<std::string, ModloaderUtils::QMod *>* uninstalledQMods = new std::unordered_map<std::string, ModloaderUtils::QMod *>();
-		for (std::pair<std::string, QMod*> qmodPair : *QMod::DownloadedQMods) {
+		for (const std::pair<const std::string, QMod*>& qmodPair : *downloadedQMods) {
 			if (!qmodPair.second->Installed()) uninstalledQMods->insert(qmodPair);
 		}
 
 		return uninstalledQMods;
 	}
 
-	void SetModActive(std::string name, bool active) {
-		getLogger().info("%s mod \"%s\"", active ? "Enabling" : "Disabling", GetLibName(name).c_str());
+	QModView ViewQMods(QModFilter filter) {
+		Init();
 
-		std::string path;
-		if (IsModALibrary(name)) path = m_LibPath;
-		else path = m_ModPath;
+		return QModView(QMod::GetDownloadedQMods(), filter);
+	}
 
-		std::list<std::string> fileNames = GetDirContents(path);
+	template<typename Visitor>
+	void ForEachQMod(QModFilter filter, Visitor&& visitor) {
+		for (QMod* qmod : ViewQMods(filter)) {
+			visitor(qmod);
+		}
+	}
 
-		for (std::string fileName : fileNames) {
-			if (!IsFileName(fileName)) continue;
-			if (strcmp(fileName.c_str(), GetFileName(name).c_str())) continue;
+	std::vector<QMod*> FindQMods(QModField field, std::string_view value, bool prefix) {
+		Init();
 
-			if (active) rename(string_format("%s/%s", path.c_str(), fileName.c_str()).c_str(), string_format("%s/%s.so", path.c_str(), GetLibName(name).c_str()).c_str());
-			else rename(string_format("%s/%s", path.c_str(), fileName.c_str()).c_str(), string_format("%s/%s.disabled", path.c_str(), GetLibName(name).c_str()).c_str());
+		return QMod::FindQMods(field, value, prefix);
+	}
 
-			return;
-		}
+	void SetModActive(std::string_view name, bool active) {
+		getLogger().info("%s mod \"%s\"", active ? "Enabling" : "Disabling", GetLibName(name).c_str());
+
+		std::optional<ModIndex::IndexEntry> entry = ModIndex::FindByFileName(GetFileName(name));
+		if (!entry.has_value()) return;
+
+		std::string path = entry->library ? m_LibPath : m_ModPath;
+
+		std::string newFileName = entry->libName + (active ? ".so" : ".disabled");
+		rename(string_format("%s/%s", path.c_str(), entry->fileName.c_str()).c_str(), string_format("%s/%s", path.c_str(), newFileName.c_str()).c_str());
+
+		ModIndex::Update(entry->fileName, entry->library);
+		ModIndex::Update(newFileName, entry->library);
 	}
 
 	void SetModsActive(std::list<std::string>* mods, bool active) {
 		getLogger().info("%s a list of mods", active ? "Enabling" : "Disabling");
 
-		for (std::string modFileName : *mods) {
+		for (const std::string& modFileName : *mods) {
 			SetModActive(modFileName, active);
 		}
 	}
 
-	void ToggleMod(std::string name) {
+	void ToggleMod(std::string_view name) {
 		SetModActive(name, IsDisabled(name));
 	}
 
 	void ToggleMods(std::list<std::string>* mods) {
 		getLogger().info("Toggling a list of mods");
 
-		for (std::string modFileName : *mods) {
+		for (const std::string& modFileName : *mods) {
 			ToggleMod(modFileName);
 		}
 	}
@@ -420,11 +552,15 @@ namespace ModloaderUtils {
 	void SetQModsActive(std::list<QMod*>* qmods, bool active) {
 		getLogger().info("%s a list of QMods", active ? "Enabling" : "Disabling");
 
+		if (active) {
+			QMod::InstallBatch(std::vector<QMod*>(qmods->begin(), qmods->end()));
+			return;
+		}
+
 		std::vector<std::optional<std::thread>> threads;
 
 		for (QMod* qmod : *qmods) {
-			if (active) threads.emplace_back(qmod->InstallAsync());
-			else threads.emplace_back(qmod->UninstallAsync());
+			threads.emplace_back(qmod->UninstallAsync());
 		}
 
 		for (auto& thread : threads) {
@@ -447,32 +583,34 @@ namespace ModloaderUtils {
 		}
 	}
 
-	bool IsDisabled(std::string name) {
-		std::string fileName = GetFileName(name);
+	bool IsDisabled(std::string_view name) {
+		std::shared_ptr<const ResolvedName> names;
+		std::string_view fileName = GetFileNameView(name, names);
 
-		return fileName.length() > 9 && !strcmp(fileName.substr(fileName.size() - 9).c_str(), ".disabled");
+		return fileName.size() > 9 && fileName.ends_with(".disabled");
 	}
 
-	bool IsOddLibName(std::string name) {
-		Init();
-		return (std::find(m_OddLibNames->begin(), m_OddLibNames->end(), name) != m_OddLibNames->end());
+	bool IsOddLibName(std::string_view name) {
+		return ModIndex::IsOddLibName(name);
 	}
 
-	bool IsModLoaded(std::string name) {
+	bool IsModLoaded(std::string_view name) {
 		Init();
-		return (std::find(m_LoadedMods->begin(), m_LoadedMods->end(), GetFileName(name)) != m_LoadedMods->end());;
+
+		std::shared_ptr<const ResolvedName> names;
+		return m_LoadedMods->contains(GetFileNameView(name, names));
 	}
 
-	bool IsCoreMod(std::string name) {
+	bool IsCoreMod(std::string_view name) {
 		Init();
-		return (std::find(m_CoreMods->begin(), m_CoreMods->end(), GetFileName(name)) != m_CoreMods->end());
-	}
 
-	bool IsModALibrary(std::string name) {
-		std::string fileName = GetFileName(name);
-		std::list<std::string> libFiles = GetDirContents(m_LibPath);
+		std::shared_ptr<const ResolvedName> names;
+		return m_CoreMods->contains(GetFileNameView(name, names));
+	}
 
-		return (std::find(libFiles.begin(), libFiles.end(), fileName) != libFiles.end());
+	bool IsModALibrary(std::string_view name) {
+		std::shared_ptr<const ResolvedName> names;
+		return ModIndex::IsLibraryFile(GetFileNameView(name, names));
 	}
 
 	// Mod Name = Mod Name
@@ -483,89 +621,86 @@ namespace ModloaderUtils {
 
 	// Name Tests
 
-	bool IsModID(std::string name) {
-		std::string fileName = GetFileName(name);
-		std::unordered_map<std::string, const Mod> mods = Modloader::getMods();
-
-		for (std::pair<std::string, const Mod> modPair : mods) {
-			if (!strcmp(fileName.c_str(), modPair.second.name.c_str())) return true;
-		}
-
-		return false;
+	bool IsModID(std::string_view name) {
+		std::shared_ptr<const ResolvedName> names;
+		return GetLoadedModsSnapshot()->ids.contains(GetFileNameView(name, names));
 	}
 
-	bool IsLibName(std::string name) {
-		return ((!IsFileName(name)) && (name.length() > 3 && !strcmp(name.substr(0, 3).c_str(), "lib"))) || IsOddLibName(name);
+	bool IsLibName(std::string_view name) {
+		return (!IsFileName(name) && name.size() > 3 && name.starts_with("lib")) || IsOddLibName(name);
 	}
 
-	bool IsFileName(std::string name) {
-		return (name.length() > 9 && !strcmp(name.substr(name.size() - 9).c_str(), ".disabled")) || (name.length() > 3 && !strcmp(name.substr(name.size() - 3).c_str(), ".so"));
+	bool IsFileName(std::string_view name) {
+		return (name.size() > 9 && name.ends_with(".disabled")) || (name.size() > 3 && name.ends_with(".so"));
 	}
 
 	// Name Conversions
 
-	std::string GetModID(std::string name) {
-		std::string fileName = GetFileName(name);
-		std::unordered_map<std::string, const Mod> mods = Modloader::getMods();
-		
-		for (std::pair<std::string, const Mod> modPair : mods) {
-			if (!strcmp(fileName.c_str(), modPair.second.name.c_str())) return modPair.first;
-		}
+	std::string GetModID(std::string_view name) {
+		std::shared_ptr<const LoadedModsSnapshot> snapshot = GetLoadedModsSnapshot();
+		std::shared_ptr<const ResolvedName> names;
+
+		auto search = snapshot->ids.find(GetFileNameView(name, names));
+		if (search != snapshot->ids.end()) return search->second;
 
 		return GetLibName(name);
 	}
 
-	std::string GetLibName(std::string name) {
-		if (IsLibName(name)) return name;
+	std::string GetLibName(std::string_view name) {
+		if (IsFileName(name)) return StripExtension(name);
 
-		std::string fileName;
+		std::shared_ptr<const ResolvedName> names = FindModNames(name);
+		if (names != nullptr) return names->libName;
+
+		return IsLibName(name) ? std::string(name) : "Null";
+	}
 
-		if (IsFileName(name)) fileName = name;
-		else fileName = GetFileNameFromModID(name);
+	std::string GetFileName(std::string_view name) {
+		if (IsFileName(name)) return std::string(name);
 
-		if (fileName == "Null") fileName = GetFileNameFromDir(name);
-		if (fileName == "Null") return "Null";
+		std::shared_ptr<const ResolvedName> names = FindModNames(name);
+		if (names != nullptr && names->fileName != "Null") return names->fileName;
 
-		if (IsDisabled(fileName)) return fileName.substr(0, fileName.size() - 9);
-		else return fileName.substr(0, fileName.size() - 3);
+		getLogger().info("Failed to get file name for \"%s\"!", std::string(name).c_str());
+		return {"Null"};
 	}
 
-	std::string GetFileName(std::string name) {
-		if (IsFileName(name)) return name;
-		std::string libName;
+	std::string GetModVersion(std::string_view name) {
+		Init();
+		std::shared_ptr<const ResolvedName> names;
 
-		if (IsLibName(name)) libName = name;
-		else libName = GetLibName(name);
+		auto search = m_ModVersions->find(GetFileNameView(name, names));
+		if (search == m_ModVersions->end()) return "Unknown";
 
-		return GetFileNameFromDir(libName);
+		return search->second;
 	}
 
-	std::string GetModVersion(std::string name) {
-		Init();
+	std::shared_ptr<const ResolvedName> FindModNames(std::string_view name) {
+		std::shared_ptr<const NameTable> table = GetNameTable();
 
-		std::string fileName = GetFileName(name);
-		if (m_ModVersions->find(fileName) == m_ModVersions->end()) return "Unknown";
+		auto search = table->names.find(name);
+		if (search == table->names.end()) return nullptr;
 
-		return m_ModVersions->at(fileName);
+		// Shares ownership of the whole table, so nothing has to be copied or allocated
+		return std::shared_ptr<const ResolvedName>(table, &search->second);
 	}
 
 	std::list<std::string> GetLoadedModsFileNames() {
 		Init();
-		return *m_LoadedMods;
+		return std::list<std::string>(m_LoadedMods->begin(), m_LoadedMods->end());
 	}
 
 	std::list<std::string> GetCoreMods() {
 		Init();
-		return *m_CoreMods;
+		return std::list<std::string>(m_CoreMods->begin(), m_CoreMods->end());
 	}
 
 	std::list<std::string> GetOddLibNames() {
-		Init();
-		return *m_OddLibNames;
+		return ModIndex::GetOddLibNames();
 	}
 
 	// Thanks for Laurie for the original code snippet: 
-	std::optional<std::string> GetModError(std::string name) {
+	std::optional<std::string> GetModError(std::string_view name) {
 		std::string fileName = GetFileName(name);
 		std::string filePath = Modloader::getDestinationPath() + fileName;
 		
@@ -629,24 +764,16 @@ namespace ModloaderUtils {
 	}
 
 	bool RemoveDuplicateMods() {
-		std::list<std::string> modFileNames = GetDirContents(m_ModPath);
-		std::list<std::string> libFileNames = GetDirContents(m_LibPath);
-
-		std::list<std::string> fileNames = modFileNames;
-		fileNames.merge(libFileNames);
-
 		bool removedDuplicate = false;
 
-		for (std::string file : fileNames) {
-			if (!IsDisabled(file)) continue;
+		for (const ModIndex::IndexEntry& entry : ModIndex::GetEntries()) {
+			if (entry.enabled) continue;
 
-			std::string enabledName = GetLibName(file) + ".so";
-			if (std::find(fileNames.begin(), fileNames.end(), enabledName) != fileNames.end()) {
-				std::string path = m_ModPath;
-				if (IsModALibrary(file)) path = m_LibPath;
+			if (ModIndex::FindByFileName(entry.libName + ".so").has_value()) {
+				remove(entry.Path().c_str());
+				ModIndex::Update(entry.fileName, entry.library);
 
-				remove(string_format("%s/%s", path.c_str(), file.c_str()).c_str());
-				getLogger().info("Removed Duplicated File \"%s\"", file.c_str());
+				getLogger().info("Removed Duplicated File \"%s\"", entry.fileName.c_str());
 
 				removedDuplicate = true;
 			}
@@ -655,6 +782,109 @@ namespace ModloaderUtils {
 		return removedDuplicate;
 	}
 
+	IntegrityReport ScanInstalledQMods() {
+		Init();
+		getLogger().info("Scanning Installed QMods...");
+
+		struct ScanJob {
+			std::string qmodId;
+			std::string path;
+			uint64_t size;
+			uint32_t crc;
+		};
+
+		IntegrityReport report;
+		std::vector<ScanJob> jobs;
+
+		std::unordered_set<std::string> claimedModFiles;
+		std::unordered_set<std::string> claimedLibFiles;
+
+		std::shared_ptr<const QMod::QModMap> downloadedQMods = QMod::GetDownloadedQMods();
+
+		for (const std::pair<const std::string, QMod*>& qmodPair : *downloadedQMods) {
+			QMod* qmod = qmodPair.second;
+			if (!qmod->Installed()) continue;
+
+			report.qmods[qmod->Id()] = {};
+
+			// The central directory has the CRC32 of every file, so we dont have to inflate anything to know what the files should be
+			ZipUtils::ZipArchive archive(qmod->Path());
+
+			auto AddJob = [&](std::string entryName, std::string path) {
+				const ZipUtils::ZipEntry* entry = archive.FindEntry(entryName);
+				if (entry == nullptr) {
+					getLogger().warning("Could not find \"%s\" in QMod \"%s\", so it can't be verified", entryName.c_str(), qmod->Id().c_str());
+					return;
+				}
+
+				jobs.push_back({qmod->Id(), path, entry->uncompressedSize, entry->crc32});
+			};
+
+			for (std::string modFile : qmod->ModFiles()) {
+				claimedModFiles.insert(modFile);
+				AddJob(modFile, m_ModPath + modFile);
+			}
+
+			for (std::string libFile : qmod->LibraryFiles()) {
+				claimedLibFiles.insert(libFile);
+				AddJob(libFile, m_LibPath + libFile);
+			}
+
+			for (FileCopy fileCopy : qmod->FileCopies()) {
+				AddJob(fileCopy.name, fileCopy.destination);
+			}
+		}
+
+		enum class ScanResult : uint8_t { Intact, Missing, Modified };
+		std::vector<ScanResult> results(jobs.size(), ScanResult::Intact);
+
+		ThreadUtils::ParallelFor(jobs.size(), [&](size_t i) {
+			const ScanJob& job = jobs[i];
+
+			struct stat fileStat;
+			if (stat(job.path.c_str(), &fileStat) != 0) {
+				results[i] = ScanResult::Missing;
+				return;
+			}
+
+			// Always hash the file, as the whole point is to catch changes the CRC cache wouldn't notice
+			std::optional<uint32_t> crc = (uint64_t)fileStat.st_size == job.size ? HashUtils::CRC32File(job.path) : std::nullopt;
+
+			if (!crc.has_value() || *crc != job.crc) {
+				results[i] = ScanResult::Modified;
+				return;
+			}
+
+			HashUtils::CacheFileCRC32(job.path, *crc);
+		});
+
+		for (size_t i = 0; i < jobs.size(); i++) {
+			if (results[i] == ScanResult::Missing) report.qmods[jobs[i].qmodId].missingFiles.push_back(jobs[i].path);
+			else if (results[i] == ScanResult::Modified) report.qmods[jobs[i].qmodId].modifiedFiles.push_back(jobs[i].path);
+		}
+
+		// QMods claim their files by the .so name, even when the mod has been disabled.
+		// Dotfiles are AtomicFile temp files that are still being written, so they aren't orphaned either
+		auto IsOrphaned = [](const std::string& fileName, const std::unordered_set<std::string>& claimedFiles) {
+			if (fileName.starts_with(".")) return false;
+			if (fileName.ends_with(".disabled")) return !claimedFiles.contains(fileName.substr(0, fileName.size() - 9) + ".so");
+
+			return !claimedFiles.contains(fileName);
+		};
+
+		for (const std::string& fileName : GetDirContents(m_ModPath)) {
+			if (IsOrphaned(fileName, claimedModFiles)) report.orphanedFiles.push_back(m_ModPath + fileName);
+		}
+
+		for (const std::string& fileName : GetDirContents(m_LibPath)) {
+			if (IsOrphaned(fileName, claimedLibFiles)) report.orphanedFiles.push_back(m_LibPath + fileName);
+		}
+
+		getLogger().info("Finished Scanning Installed QMods! Checked %lu files, found %lu orphaned files", jobs.size(), report.orphanedFiles.size());
+
+		return report;
+	}
+
 	void CollectCoreMods() {
 		std::ifstream coreModsFile("/sdcard/BMBFData/core-mods.json");
 		std::stringstream coreModsSS;
@@ -675,21 +905,19 @@ namespace ModloaderUtils {
 				std::string id = coreModInfo["id"].GetString();
 				std::string fileName = GetFileName(coreModInfo["id"].GetString());
 
-				m_CoreMods->emplace_front(fileName);
+				m_CoreMods->insert(fileName);
 				getLogger().info("Found Core mod %s", fileName.c_str());
 
-				bool foundQMod = false;
-				for (std::pair<std::string, QMod*> qmodPair : *QMod::DownloadedQMods) {
-					if (qmodPair.second->Id() == id) {
-						foundQMod = true;
-						QMod::CoreQMods->insert(qmodPair);
-						break;
-					}
-				}
+				QMod* coreQMod = QMod::GetDownloadedQMod(id);
 
-				if (!foundQMod) {
+				if (coreQMod != nullptr) {
+					QMod::AddCoreQMod(coreQMod);
+				} else {
 					getLogger().warning("Warning! No downloaded QMod found for core mod \"%s\". Attempting to download now...", id.c_str());
-					QMod::InstallFromUrl(coreModInfo["filename"].GetString(), coreModInfo["downloadLink"].GetString());
+					// Core mods are what everything else depends on, so get them downloaded before anything else
+					std::string sha256 = coreModInfo.HasMember("sha256") && coreModInfo["sha256"].IsString() ? coreModInfo["sha256"].GetString() : "";
+
+					QMod::InstallFromUrl(coreModInfo["filename"].GetString(), coreModInfo["downloadLink"].GetString(), new std::vector<std::string>(), RequestPriority::High, sha256);
 				}
 			}
 		} else {
@@ -700,42 +928,22 @@ namespace ModloaderUtils {
 	}
 
 	void CollectLoadedMods() {
-		for (std::pair<std::string, const Mod> modPair : Modloader::getMods()) {
-			m_LoadedMods->emplace_front(modPair.second.name);
+		for (const std::pair<const std::string, const Mod>& modPair : GetLoadedModsSnapshot()->mods) {
+			m_LoadedMods->insert(modPair.second.name);
 		}
 
 		// As Modloader only keeps track of loaded mods, not libs, we have to collect the ourself
-		for (std::string fileName : GetDirContents(m_LibPath)) {
-			if (GetModError(fileName) == std::nullopt) m_LoadedMods->emplace_front(fileName);
+		for (const ModIndex::IndexEntry& entry : ModIndex::GetEntries()) {
+			if (entry.library && GetModError(entry.fileName) == std::nullopt) m_LoadedMods->insert(entry.fileName);
 		}
 	}
 
 	void CollectModVersions() {
-		for (std::pair<std::string, const Mod> modPair : Modloader::getMods()) {
+		for (const std::pair<const std::string, const Mod>& modPair : GetLoadedModsSnapshot()->mods) {
 			m_ModVersions->emplace(modPair.second.name, modPair.second.info.version);
 		}
 	}
 
-	void CollectOddLibs() {
-		m_OddLibNames->clear();
-		std::list<std::string> modFileNames = GetDirContents(m_ModPath);
-		std::list<std::string> libFileNames = GetDirContents(m_LibPath);
-
-		std::list<std::string> fileNames = modFileNames;
-		fileNames.merge(libFileNames);
-
-		for (std::string fileName : fileNames) {
-			if (!IsFileName(fileName)) continue;
-
-			if (strcmp(fileName.substr(0, 3).c_str(), "lib")) {
-				getLogger().info("Mod \"%s\" does not start with \"lib\"! Adding to m_OddLibNames", fileName.c_str());
-
-				if (IsDisabled(fileName)) m_OddLibNames->emplace_front(fileName.substr(0, fileName.size() - 9));
-				else m_OddLibNames->emplace_front(fileName.substr(0, fileName.size() - 3));
-			}
-		}
-	}
-
 	void CollectPackageName() {
 		getLogger().info("Collecting Package Name...");
 		JNIEnv* env = JNIUtils::GetJNIEnv();
@@ -759,47 +967,132 @@ namespace ModloaderUtils {
 	void CollectDownloadedQMods() {
 		getLogger().info("Collecting Downloaded QMods...");
 
-		QMod::DownloadedQMods->clear();
 		std::list<std::string> fileNames = GetDirContents(m_QModPath);
+		std::vector<QMod*> qmods;
 
 		for (std::string file : fileNames) {
 			std::string filePath = m_QModPath + file;
-			QMod* qmod = new QMod(filePath, false);
+
+			// Published all at once below, rather than each QMod copying the registry to add itself
+			QMod* qmod = new QMod(filePath, false, false);
 
 			if (qmod->Valid()) {
 				getLogger().info("Found QMod File \"%s\"", file.c_str());
-				QMod::DownloadedQMods->insert({qmod->Id(), qmod});
+				qmods.push_back(qmod);
 			}
 		}
 
+		QMod::SetDownloadedQMods(qmods);
+
 		getLogger().info("Finished Collecting Downloaded QMods!");
 	}
 
 	std::string GetFileNameFromDir(std::string libName, bool guessLibName) {
-		std::list<std::string> modFileNames = GetDirContents(m_ModPath);
-		std::list<std::string> libFileNames = GetDirContents(m_LibPath);
-
-		std::list<std::string> fileNames = modFileNames;
-		fileNames.merge(libFileNames);
-
-		if (guessLibName) libName = "lib" + libName;
-			
-		for (std::string fileName : fileNames) {
-			if (!strcmp(GetLibName(fileName).c_str(), libName.c_str())) return fileName;
-		}
+		// Guessing the lib name is the same as looking it up by its stem
+		std::optional<ModIndex::IndexEntry> entry = guessLibName ? ModIndex::FindByStem(libName) : ModIndex::FindByLibName(libName);
+		if (entry.has_value()) return entry->fileName;
 
 		if (!guessLibName) {
 			return GetFileNameFromDir(libName, true); // Just try gussing it xD
 		}
 
-		getLogger().info("Failed to get file name for \"%s\"!", libName.c_str());
 		return {"Null"};
 	}
 
 	std::string GetFileNameFromModID(std::string modID) {
-		if (!Modloader::getMods().contains(modID)) return {"Null"};
+		std::shared_ptr<const LoadedModsSnapshot> snapshot = GetLoadedModsSnapshot();
+
+		auto search = snapshot->mods.find(modID);
+		if (search == snapshot->mods.end()) return {"Null"};
+
+		return search->second.name;
+	}
+
+	std::shared_ptr<const NameTable> GetNameTable() {
+		// Read the generation first, so if the index changes while we're building the table it just gets built again next time
+		uint64_t generation = ModIndex::GetGeneration();
+		std::shared_ptr<const LoadedModsSnapshot> snapshot = GetLoadedModsSnapshot();
+
+		std::shared_ptr<const NameTable> table = std::atomic_load(&m_NameTable);
+		if (table != nullptr && table->generation == generation && table->modsGeneration == snapshot->generation) return table;
+
+		std::shared_ptr<NameTable> newTable = std::make_shared<NameTable>();
+		newTable->generation = generation;
+		newTable->modsGeneration = snapshot->generation;
+
+		auto AddName = [&](std::string name) {
+			if (!newTable->names.contains(name)) newTable->names.emplace(name, ResolveName(name));
+		};
+
+		for (const ModIndex::IndexEntry& entry : ModIndex::GetEntries()) {
+			newTable->names.emplace(entry.fileName, ResolvedName{entry.libName, entry.fileName});
+
+			AddName(entry.libName);
+			if (entry.libName.starts_with("lib")) AddName(entry.libName.substr(3));
+		}
+
+		for (const std::pair<const std::string, const Mod>& modPair : snapshot->mods) {
+			AddName(modPair.first);
+		}
+
+		table = newTable;
+		std::atomic_store(&m_NameTable, table);
+
+		return table;
+	}
+
+	void RefreshLoadedMods() {
+		static std::atomic<uint64_t> generation = 0;
+
+		// getMods() copies every mod, so this is the only place it's called
+		std::unordered_map<std::string, const Mod> mods = Modloader::getMods();
+
+		std::shared_ptr<LoadedModsSnapshot> newSnapshot = std::make_shared<LoadedModsSnapshot>();
+		newSnapshot->generation = ++generation;
+		newSnapshot->mods = StringMap<const Mod>(mods.begin(), mods.end());
+
+		for (const std::pair<const std::string, const Mod>& modPair : newSnapshot->mods) {
+			newSnapshot->ids.emplace(modPair.second.name, modPair.first);
+		}
+
+		std::atomic_store(&m_LoadedModsSnapshot, std::shared_ptr<const LoadedModsSnapshot>(newSnapshot));
+	}
+
+	std::shared_ptr<const LoadedModsSnapshot> GetLoadedModsSnapshot() {
+		std::shared_ptr<const LoadedModsSnapshot> snapshot = std::atomic_load(&m_LoadedModsSnapshot);
+		if (snapshot != nullptr) return snapshot;
+
+		// Only happens if we're used before Init
+		RefreshLoadedMods();
+		return std::atomic_load(&m_LoadedModsSnapshot);
+	}
+
+	ResolvedName ResolveName(std::string name) {
+		ResolvedName resolved;
+
+		if (IsLibName(name)) {
+			resolved.libName = name;
+		} else {
+			std::string fileName = GetFileNameFromModID(name);
+
+			if (fileName == "Null") fileName = GetFileNameFromDir(name);
+			resolved.libName = fileName == "Null" ? "Null" : StripExtension(fileName);
+		}
 
-		return Modloader::getMods().at(modID).name;
+		resolved.fileName = GetFileNameFromDir(resolved.libName);
+		return resolved;
+	}
+
+	std::string StripExtension(std::string_view fileName) {
+		if (fileName.ends_with(".disabled")) return std::string(fileName.substr(0, fileName.size() - 9));
+		else return std::string(fileName.substr(0, fileName.size() - 3));
+	}
+
+	std::string_view GetFileNameView(std::string_view name, std::shared_ptr<const ResolvedName>& names) {
+		if (IsFileName(name)) return name;
+
+		names = FindModNames(name);
+		return names != nullptr ? std::string_view(names->fileName) : std::string_view("Null");
 	}
 
 	void Init() {
@@ -812,16 +1105,19 @@ namespace ModloaderUtils {
 		m_LibPath = "/sdcard/Android/data/com.beatgames.beatsaber/files/libs/";
 		m_QModPath = "/sdcard/BMBFData/Mods/";
 
-		m_CoreMods = new std::list<std::string>();
-		m_OddLibNames = new std::list<std::string>();
-		m_LoadedMods = new std::list<std::string>();
-		m_ModVersions = new std::unordered_map<std::string, std::string>();
+		// Keeps ModIndex up to date when other apps change the mod folders
+		if (!ModWatcher::Start()) getLogger().warning("Failed to watch the mod folders for changes! Changes made by other apps won't be noticed");
+
+		m_CoreMods = new StringSet();
+		m_LoadedMods = new StringSet();
+		m_ModVersions = new StringMap<std::string>();
 
 		CollectPackageName();
 		CollectGameVersion();
+
+		RefreshLoadedMods();
 		CollectLoadedMods();
 		CollectModVersions();
-		CollectOddLibs();
 
 		CollectDownloadedQMods();
 		CollectCoreMods();
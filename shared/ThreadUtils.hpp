@@ -0,0 +1,128 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <algorithm>
+
+namespace ModloaderUtils {
+	namespace ThreadUtils {
+		/**
+		 * @brief Gets how many threads should be used to run a number of independent jobs
+		 *
+		 * @param jobCount The number of jobs that need to be run
+		 * @return The number of threads to use, which is never more than the number of cores or jobs
+		 */
+		inline size_t GetWorkerCount(size_t jobCount) {
+			size_t cores = std::max(1u, std::thread::hardware_concurrency());
+			return std::max<size_t>(1, std::min(cores, jobCount));
+		}
+
+		/**
+		 * @brief Runs a function for every index in [0, count) across all cores
+		 * @details Jobs are handed out one at a time, so uneven jobs (like a big .so next to a tiny config file) still spread evenly.
+		 * The calling thread works on jobs too, and this only returns once every job is done
+		 *
+		 * @param count The number of jobs
+		 * @param func The job, called as `func(size_t index)`. Must be safe to call from multiple threads at once
+		 */
+		template<typename Func>
+		void ParallelFor(size_t count, Func&& func) {
+			if (count == 0) return;
+
+			std::atomic<size_t> nextIndex = 0;
+			auto worker = [&]() {
+				for (size_t i = nextIndex++; i < count; i = nextIndex++) {
+					func(i);
+				}
+			};
+
+			std::vector<std::thread> threads;
+			size_t workerCount = GetWorkerCount(count);
+
+			for (size_t i = 1; i < workerCount; i++) {
+				threads.emplace_back(worker);
+			}
+
+			worker();
+
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+
+		/**
+		 * A queue that holds a limited number of items, for passing work from one thread to another.
+		 * Pushing blocks while the queue is full, so a fast producer cant run too far ahead of a slow consumer.
+		 * Once the producer is done it closes the queue, and the consumer gets everything that was left before Pop() returns nullopt
+		 */
+		template<typename T>
+		class BoundedQueue {
+		public:
+			BoundedQueue(size_t capacity) : m_Capacity(std::max<size_t>(1, capacity)) {}
+
+			BoundedQueue(const BoundedQueue&) = delete;
+			BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+			/**
+			 * @brief Adds an item, waiting for space if the queue is full
+			 *
+			 * @param item The item to add
+			 * @return Returns false if the queue was closed, in which case the item is dropped
+			 */
+			bool Push(T item) {
+				std::unique_lock guard(m_Lock);
+				m_NotFull.wait(guard, [this] { return m_Closed || m_Items.size() < m_Capacity; });
+
+				if (m_Closed) return false;
+
+				m_Items.push_back(std::move(item));
+				m_NotEmpty.notify_one();
+
+				return true;
+			}
+
+			/**
+			 * @brief Takes the oldest item, waiting for one if the queue is empty
+			 *
+			 * @return The item, or nullopt if the queue is closed and empty
+			 */
+			std::optional<T> Pop() {
+				std::unique_lock guard(m_Lock);
+				m_NotEmpty.wait(guard, [this] { return m_Closed || !m_Items.empty(); });
+
+				if (m_Items.empty()) return std::nullopt;
+
+				T item = std::move(m_Items.front());
+				m_Items.pop_front();
+				m_NotFull.notify_one();
+
+				return item;
+			}
+
+			/**
+			 * @brief Stops any more items being added, and wakes up anything waiting on the queue
+			 */
+			void Close() {
+				std::unique_lock guard(m_Lock);
+				m_Closed = true;
+
+				m_NotEmpty.notify_all();
+				m_NotFull.notify_all();
+			}
+
+		private:
+			std::mutex m_Lock;
+			std::condition_variable m_NotEmpty;
+			std::condition_variable m_NotFull;
+
+			std::deque<T> m_Items;
+			size_t m_Capacity;
+			bool m_Closed = false;
+		};
+	}
+}
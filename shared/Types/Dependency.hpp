@@ -7,5 +7,8 @@ namespace ModloaderUtils {
 		std::string id;
 		std::string version;
 		std::string downloadIfMissing;
+
+		// The SHA-256 the downloaded QMod should have, if the mod.json gives one
+		std::string sha256;
 	};
 }
\ No newline at end of file
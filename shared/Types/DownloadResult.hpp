@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace ModloaderUtils {
+	struct DownloadResult {
+		bool success = false;
+
+		// Hashes of the downloaded file, worked out while it was being written
+		uint64_t size = 0;
+		uint32_t crc32 = 0;
+		std::string sha256;
+
+		explicit operator bool() const { return success; }
+	};
+}
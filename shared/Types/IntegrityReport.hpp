@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace ModloaderUtils {
+	struct QModIntegrity {
+		std::vector<std::string> missingFiles;
+		std::vector<std::string> modifiedFiles;
+
+		const inline bool Intact() const { return missingFiles.empty() && modifiedFiles.empty(); }
+	};
+
+	struct IntegrityReport {
+		// Keyed by QMod ID, only contains installed QMods
+		std::unordered_map<std::string, QModIntegrity> qmods;
+
+		// Files in the mods and libs folders that no installed QMod says it installed
+		std::vector<std::string> orphanedFiles;
+	};
+}
@@ -7,12 +7,26 @@
 #include <fstream>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <future>
+#include <unordered_map>
+#include <map>
+#include <string_view>
+#include <functional>
 
 #include "cpp-semver/shared/cpp-semver.hpp"
 
 #include "modloader-utils/shared/Types/Dependency.hpp"
 #include "modloader-utils/shared/Types/FileCopy.hpp"
+#include "modloader-utils/shared/Types/QModFilter.hpp"
+#include "modloader-utils/shared/Types/QModField.hpp"
 #include "modloader-utils/shared/WebUtils.hpp"
+#include "modloader-utils/shared/ZipUtils.hpp"
+#include "modloader-utils/shared/ThreadUtils.hpp"
+#include "modloader-utils/shared/FileUtils.hpp"
+#include "modloader-utils/shared/HashUtils.hpp"
+#include "modloader-utils/shared/ArtifactStore.hpp"
+#include "modloader-utils/shared/ModIndex.hpp"
 
 #include "jni-utils/shared/JNIUtils.hpp"
 
@@ -29,8 +43,12 @@
 			if (verbos)                                                                                                                  \
 				getLogger().info("[%s] QMOD ASSERT [%s:%i]: Condition \"%s\" Failed!", name.c_str(), __FILE__, __LINE__, "" #condition); \
                                                                                                                                          \
-			CleanupTempDir(name);                                                                                                        \
-			CleanupTempDir(string_format("Downloads/%s.qmod", name.c_str()), true);                                                      \
+			/* Nothing is extracted before this point, so only downloaded archives need cleaning up */                                   \
+			if (m_Path.starts_with("/sdcard/BMBFData/Mods/Temp/"))                                                                       \
+			{                                                                                                                            \
+				CleanupTempDir(name);                                                                                                    \
+				CleanupTempDir(string_format("Downloads/%s.qmod", name.c_str()), true);                                                  \
+			}                                                                                                                            \
                                                                                                                                          \
 			m_Valid = false;                                                                                                             \
 			return;                                                                                                                      \
@@ -84,8 +102,9 @@
 				std::string id = GET_STRING("id", dependencyValue);                               \
 				std::string version = GET_STRING("version", dependencyValue);                     \
 				std::string downloadIfMissing = GET_STRING("downloadIfMissing", dependencyValue); \
+				std::string sha256 = GET_STRING("sha256", dependencyValue);                       \
                                                                                                   \
-				dependencies->push_back({id, version, downloadIfMissing});                        \
+				dependencies->push_back({id, version, downloadIfMissing, sha256});                \
 			}                                                                                     \
 		}                                                                                         \
 	}
@@ -112,30 +131,29 @@ namespace ModloaderUtils
 	class QMod
 	{
 	public:
-		inline static std::unordered_map<std::string, QMod*>* DownloadedQMods = new std::unordered_map<std::string, QMod*>();
-		inline static std::unordered_map<std::string, QMod*>* CoreQMods = new std::unordered_map<std::string, QMod*>();
+		using QModMap = std::unordered_map<std::string, QMod *>;
 
-		QMod(std::string fileDir, bool verbos = true)
-		{
-			std::string tmpDir = GetTempDir(fileDir);
+		// Called as QMods download, including dependencies, with the file name or dependency ID being downloaded. Runs on the download thread, so set it before installing anything
+		inline static std::function<void(std::string name, const TransferProgress &progress)> OnDownloadProgress;
 
-			// Create Temp Dir To Read the mod.json
+		// How many QMods can be waiting between each stage of InstallBatch
+		inline static size_t BatchQueueSize = 4;
 
-			std::system(string_format("mkdir -p \"%s\"", tmpDir.c_str()).c_str());
-			std::system(string_format("unzip \"%s\" mod.json -d \"%s\"", fileDir.c_str(), tmpDir.c_str()).c_str());
+		// If publish is false, the QMod isnt added to the downloaded QMods, so a lot of them can be added at once with SetDownloadedQMods
+		QMod(std::string fileDir, bool verbos = true, bool publish = true)
+		{
+			m_Path = fileDir;
 
-			// Read the mod.json
+			// Read the mod.json straight out of the archive
 
-			std::ifstream qmodFile(string_format("%smod.json", tmpDir.c_str()).c_str());
+			ZipUtils::ZipArchive archive(fileDir);
+			ASSERT(archive.Valid(), GetFileName(fileDir), verbos);
 
-			std::stringstream qmodJson;
-			qmodJson << qmodFile.rdbuf();
+			std::optional<std::string> qmodJson = archive.ReadEntry("mod.json");
+			ASSERT(qmodJson.has_value(), GetFileName(fileDir), verbos);
 
 			rapidjson::Document document;
-			ASSERT(!document.Parse(qmodJson.str().c_str()).HasParseError(), GetFileName(fileDir), verbos);
-
-			// Clean Up Temp Dirs
-			CleanupTempDir(GetFileName(fileDir));
+			ASSERT(!document.Parse(qmodJson->data(), qmodJson->size()).HasParseError(), GetFileName(fileDir), verbos);
 
 			// Get Values
 
@@ -161,13 +179,16 @@ namespace ModloaderUtils
 			m_FileCopies = new std::vector<FileCopy>();
 			GET_FILE_COPIES(document["fileCopies"], m_FileCopies);
 
-			m_Path = fileDir;
+			m_ArchiveHash = string_format("%08x", archive.Fingerprint());
 
 			// Attempt to load BMBF Specific Data
 			CollectBMBFData(verbos);
 
-			DownloadedQMods->insert({this->m_Id, this});
+			// Other threads can find us as soon as we're in the registry, so we have to be fully set up first
 			m_Valid = true;
+
+			if (publish)
+				UpdateRegistry(DownloadedQMods, [this](Registry &registry) { registry.Add(this); });
 		}
 
 		void Install(std::vector<std::string> *installedInBranch = new std::vector<std::string>())
@@ -176,15 +197,15 @@ namespace ModloaderUtils
 			if (thread.has_value()) thread.value().detach();
 		}
 
-		static void InstallFromUrl(std::string fileName, std::string url, std::vector<std::string> *installedInBranch = new std::vector<std::string>())
+		static void InstallFromUrl(std::string fileName, std::string url, std::vector<std::string> *installedInBranch = new std::vector<std::string>(), RequestPriority priority = RequestPriority::Normal, std::string expectedSHA256 = "")
 		{
 			CollectAppPackageId();
 			auto t = std::thread(
-				[fileName, url, installedInBranch]
+				[fileName, url, installedInBranch, priority, expectedSHA256]
 				{
 					std::string downloadFileLoc = string_format("/sdcard/BMBFData/Mods/Temp/Downloads/%s", fileName.c_str());
 
-					if (!WebUtils::DownloadFile(fileName, url, downloadFileLoc))
+					if (!WebUtils::DownloadFile(fileName, url, downloadFileLoc, priority, expectedSHA256, GetProgressReporter(fileName)))
 					{
 						CleanupTempDir(string_format("Downloads/%s", fileName.c_str()).c_str(), true);
 						return;
@@ -207,98 +228,82 @@ namespace ModloaderUtils
 
 		std::optional<std::thread> InstallAsync(std::vector<std::string> *installedInBranch = new std::vector<std::string>())
 		{
-			if (!m_Valid)
-			{
-				getLogger().info("Mod \"%s\" Is an invalid QMod!", m_Id.c_str());
-				return std::nullopt;
-			}
-
-			CollectAppPackageId();
-			if (m_PackageId != AppPackageId)
-			{
-				getLogger().info("Mod \"%s\" Is not built for the package \"%s\", but instead is built for \"%s\"!", m_Id.c_str(), AppPackageId.c_str(), m_PackageId.c_str());
+			if (!CanInstall())
 				return std::nullopt;
-			}
 
 			getLogger().info("Installing mod \"%s\"", m_Id.c_str());
 
 			return std::thread(
 				[this, installedInBranch] {
-					if (!m_Valid)
-					{
-						getLogger().info("Mod \"%s\" Is an invalid QMod!", m_Id.c_str());
+					if (!PrepareInstall(installedInBranch))
 						return;
-					}
 
-					if (m_Installed)
-					{
-						getLogger().info("Mod \"%s\" Already Installed!", m_Id.c_str());
+					if (!PlaceFiles(installedInBranch))
 						return;
-					}
-
-					// Add to the installed tree so that dependencies further down on us will trigger a recursive install error
-					installedInBranch->push_back(m_Id);
 
-					// We say that the mod is installed now to prevent multiple installs of the same mod If the install fails we can then can say its uninstalled later
-					m_Installed = true;
+					CommitInstall();
+				}
+			);
+		}
 
-					for (Dependency dependency : *m_Dependencies)
-					{
-						if (!PrepareDependency(dependency, installedInBranch))
-						{
-							getLogger().error("Failed to install \"%s\" as one of its dependencies (%s) also failed to install", m_Id.c_str(), dependency.id.c_str());
+		/**
+		 * @brief Installs a batch of QMods, overlapping the work for different QMods
+		 * @details Installing is split into stages, which are connected by bounded queues so every stage can work on a different QMod at once.
+		 * Dependencies are resolved and downloaded for several QMods at a time, files are placed one QMod at a time (with the extraction itself spread across every core),
+		 * and BMBF's config is updated for one QMod while the next one's files are being placed. This blocks until every QMod has been installed or has failed
+		 *
+		 * @param qmods The QMods to install
+		 */
+		static void InstallBatch(const std::vector<QMod *> &qmods)
+		{
+			std::vector<QMod *> installable;
 
-							m_Installed = false;
-							return;
-						}
-					}
+			for (QMod *qmod : qmods)
+			{
+				if (qmod->CanInstall())
+					installable.push_back(qmod);
+			}
 
-					// We only lock now so that the dependencies can install first without issues
-					std::unique_lock guard(InstallLock);
+			getLogger().info("Installing a batch of %lu mods", installable.size());
 
-					// Extract QMod so we can move the files
-					ExtractQMod();
+			// Each QMod gets its own branch for catching recursive dependencies, the same as installing it on its own would
+			std::vector<std::vector<std::string>> branches(installable.size());
 
-					std::string tmpDir = GetTempDir(m_Path);
-					std::string modsExtractionPath = tmpDir + "Mods/";
-					std::string libsExtractionPath = tmpDir + "Libs/";
-					std::string fileCopiesExtractionPath = tmpDir + "FileCopies/";
+			// Items are indexes into installable
+			ThreadUtils::BoundedQueue<size_t> placeQueue(BatchQueueSize);
+			ThreadUtils::BoundedQueue<size_t> commitQueue(BatchQueueSize);
 
-					// Copy the Mods files to the Mods folder
-					for (std::string mod : *m_ModFiles)
+			std::thread placer(
+				[&] {
+					while (std::optional<size_t> index = placeQueue.Pop())
 					{
-						std::system(string_format("mv -f \"%s%s\" \"/sdcard/Android/data/com.beatgames.beatsaber/files/mods/\"", modsExtractionPath.c_str(), mod.c_str()).c_str());
+						if (installable[*index]->PlaceFiles(&branches[*index]))
+							commitQueue.Push(*index);
 					}
 
-					// Copy the Libs files to the Libs folder
-					for (std::string lib : *m_LibraryFiles)
-					{
-						std::system(string_format("mv -f \"%s%s\" \"/sdcard/Android/data/com.beatgames.beatsaber/files/libs/\"", libsExtractionPath.c_str(), lib.c_str()).c_str());
-					}
+					commitQueue.Close();
+				}
+			);
 
-					// Copy the File Copies to their respective destination folders
-					for (FileCopy fileCopy : *m_FileCopies)
+			std::thread committer(
+				[&] {
+					while (std::optional<size_t> index = commitQueue.Pop())
 					{
-						std::string desPath = fileCopy.destination.substr(0, fileCopy.destination.find_last_of("/\\"));
-
-						std::system(string_format("mkdir -p \"%s\"", desPath.c_str()).c_str());
-						std::remove(fileCopy.destination.c_str());
-
-						std::system(string_format("mv -f \"%s%s\" \"%s\"", fileCopiesExtractionPath.c_str(), fileCopy.name.c_str(), fileCopy.destination.c_str()).c_str());
+						installable[*index]->CommitInstall();
 					}
+				}
+			);
 
-					installedInBranch->erase(std::remove(installedInBranch->begin(), installedInBranch->end(), m_Id), installedInBranch->end());
+			// Preparing is mostly waiting on downloads, so run as many as we have cores for
+			ThreadUtils::ParallelFor(installable.size(), [&](size_t index) {
+				if (installable[index]->PrepareInstall(&branches[index]))
+					placeQueue.Push(index);
+			});
 
-					// If QMod is for Beat Saber, then Update its BMBF Data
-					if (!strcmp(m_PackageId.c_str(), "com.beatgames.beatsaber"))
-					{
-						UpdateBMBFData();
-					}
+			placeQueue.Close();
 
-					getLogger().info("Successfully Installed \"%s\"!", m_Id.c_str());
-					CleanupTempDir(GetFileName(m_Path));
-				}
-			);
+			placer.join();
+			committer.join();
 		}
 
 		std::optional<std::thread> UninstallAsync(bool onlyDisable = true, bool verbos = true)
@@ -330,19 +335,25 @@ namespace ModloaderUtils
 					if (verbos)
 						getLogger().info("Uninstalling \"%s\"", m_Id.c_str());
 
+					// Disabled files are kept in the artifact store so they can be enabled again without extracting them
+					ZipUtils::ZipArchive archive(m_Path);
+
 					// Remove mod SOs so that the mod will not load
 					for (std::string modFile : *m_ModFiles)
 					{
 						if (verbos)
 							getLogger().info("Removing Mod file \"%s\" from mod \"%s\"", modFile.c_str(), m_Id.c_str());
-						std::system(string_format("rm -f \"/sdcard/Android/data/com.beatgames.beatsaber/files/mods/%s\"", modFile.c_str()).c_str());
+						RemoveInstalledFile(archive, modFile, string_format("/sdcard/Android/data/com.beatgames.beatsaber/files/mods/%s", modFile.c_str()), onlyDisable);
 					}
 
 					// Only Remove Libs if they are not needed elsewhere
+					std::shared_ptr<const QModMap> downloadedQMods = GetDownloadedQMods();
+
 					for (std::string libFile : *m_LibraryFiles)
 					{
 						bool isUsedElsewhere = false;
-						for (std::pair<std::string, QMod *> modPair : *DownloadedQMods)
+
+						for (const std::pair<const std::string, QMod *> &modPair : *downloadedQMods)
 						{
 							QMod *otherMod = modPair.second;
 							if (otherMod == this || !otherMod->m_Installed)
@@ -361,7 +372,7 @@ namespace ModloaderUtils
 						{
 							if (verbos)
 								getLogger().info("Removing Library file \"%s\" from mod \"%s\"", libFile.c_str(), m_Id.c_str());
-							std::system(string_format("rm -f \"/sdcard/Android/data/com.beatgames.beatsaber/files/libs/%s\"", libFile.c_str()).c_str());
+							RemoveInstalledFile(archive, libFile, string_format("/sdcard/Android/data/com.beatgames.beatsaber/files/libs/%s", libFile.c_str()), onlyDisable);
 						}
 					}
 
@@ -373,7 +384,12 @@ namespace ModloaderUtils
 						std::system(string_format("rm -f \"%s\"", fileCopy.destination.c_str()).c_str());
 					}
 
-					m_Installed = false;
+					UpdateModIndex();
+
+					{
+						std::unique_lock installsGuard(InFlightInstallsLock);
+						m_Installed = false;
+					}
 
 					// If QMod is for Beat Saber, then Remove its BMBF Data
 					if (!strcmp(m_PackageId.c_str(), "com.beatgames.beatsaber"))
@@ -389,9 +405,10 @@ namespace ModloaderUtils
 					// This is for actually removing the qmod, not just disabling it
 					if (!onlyDisable)
 					{
-						DownloadedQMods->erase(m_Id);
+						UpdateRegistry(DownloadedQMods, [this](Registry &registry) { registry.Remove(m_Id); });
 
-						std::system(string_format("rm -f \"sdcard/BMBFData/Mods/%s_%s\"", GetFileName(m_Path).c_str(), m_CoverImage.c_str()).c_str());
+						if (m_CoverImage != "")
+							unlink(GetCoverImageCachePath().c_str());
 						std::system(string_format("rm -f \"%s\"", m_Path.c_str()).c_str());
 					}
 
@@ -401,35 +418,164 @@ namespace ModloaderUtils
 			);
 		}
 
-		const inline std::string Name() { return m_Name; }
-		const inline std::string Id() { return m_Id; }
-		const inline std::string Description() { return m_Description; }
-		const inline std::string Author() { return m_Author; }
-		const inline std::string Porter() { return m_Porter; }
-		const inline std::string Version() { return m_Version; }
-		const inline std::string CoverImage() { return m_CoverImage; }
+		// These never change once the QMod has been read, so they're returned by reference rather than copied
 
-		const inline std::string PackageId() { return m_PackageId; }
-		const inline std::string PackageVersion() { return m_PackageVersion; }
+		const inline std::string &Name() { return m_Name; }
+		const inline std::string &Id() { return m_Id; }
+		const inline std::string &Description() { return m_Description; }
+		const inline std::string &Author() { return m_Author; }
+		const inline std::string &Porter() { return m_Porter; }
+		const inline std::string &Version() { return m_Version; }
+		const inline std::string &CoverImage() { return m_CoverImage; }
 
-		const inline std::vector<std::string> ModFiles() { return *m_ModFiles; }
-		const inline std::vector<std::string> LibraryFiles() { return *m_LibraryFiles; }
-		const inline std::vector<Dependency> Dependencies() { return *m_Dependencies; }
-		const inline std::vector<FileCopy> FileCopies() { return *m_FileCopies; }
+		const inline std::string &PackageId() { return m_PackageId; }
+		const inline std::string &PackageVersion() { return m_PackageVersion; }
 
-		const inline std::string Path() { return m_Path; }
+		const inline std::vector<std::string> &ModFiles() { return *m_ModFiles; }
+		const inline std::vector<std::string> &LibraryFiles() { return *m_LibraryFiles; }
+		const inline std::vector<Dependency> &Dependencies() { return *m_Dependencies; }
+		const inline std::vector<FileCopy> &FileCopies() { return *m_FileCopies; }
+
+		const inline std::string Path()
+		{
+			std::unique_lock guard(PathLock);
+			return m_Path;
+		}
 		const inline std::string CoverImageFilename() { return m_CoverImageFilename; }
 
 		const inline bool Installed() { return m_Installed; }
 		const inline bool Uninstallable() { return m_Uninstallable; }
 		const inline bool Valid() { return m_Valid; }
 
-		const inline std::string FileName() { return GetFileName(m_Path, false, true); }
+		const inline std::string FileName() { return GetFileName(Path(), false, true); }
+
+		/**
+		 * @brief Gets the path to this QMod's cover image, extracting it the first time it's asked for
+		 * @details Covers are cached by the QMod's archive hash, so each version of a QMod only ever has its cover extracted once
+		 *
+		 * @return The path to the cover image, or nullopt if the QMod doesnt have a cover or it couldnt be extracted
+		 */
+		std::optional<std::string> CoverImagePath()
+		{
+			if (!m_Valid || m_CoverImage == "")
+				return std::nullopt;
+
+			std::string coverPath = GetCoverImageCachePath();
+
+			struct stat coverStat;
+			if (stat(coverPath.c_str(), &coverStat) == 0)
+				return coverPath;
+
+			// The archive is mapped once it's open, so it only matters if it gets moved into BMBF's folder before then, in which case we just try again from there
+			std::string path = Path();
+			std::optional<ZipUtils::ZipArchive> archive;
+			archive.emplace(path);
+
+			if (!archive->Valid() && Path() != path)
+				archive.emplace(Path());
+
+			const ZipUtils::ZipEntry *entry = archive->FindEntry(m_CoverImage);
+
+			if (entry == nullptr || !archive->ExtractEntry(*entry, coverPath))
+			{
+				getLogger().error("Failed to extract cover image \"%s\" from \"%s\"", m_CoverImage.c_str(), m_Id.c_str());
+				return std::nullopt;
+			}
+
+			return coverPath;
+		}
+
+		/**
+		 * @brief Gets every QMod that's downloaded right now, keyed by ID
+		 * @details The map is a snapshot which is never modified, so it can be read from any thread without locking, and stays valid for as long as it's held.
+		 * QMods that are downloaded or removed afterwards only show up in snapshots taken after that
+		 *
+		 * @return The downloaded QMods
+		 */
+		static std::shared_ptr<const QModMap> GetDownloadedQMods()
+		{
+			std::shared_ptr<const Registry> registry = std::atomic_load(&DownloadedQMods);
+
+			// Shares ownership of the whole registry, which the map is part of
+			return std::shared_ptr<const QModMap>(registry, &registry->qmods);
+		}
+
+		/**
+		 * @brief Finds the downloaded QMods where a field matches a value
+		 * @details QMods are indexed as they're downloaded and removed, so this never has to look through every QMod
+		 *
+		 * @param field Which field to search
+		 * @param value The value to look for
+		 * @param prefix If true, matches QMods where the field starts with the value, rather than being exactly the value
+		 * @return The matching QMods. Each QMod is only included once, even if more than one of its library files or file copies match
+		 */
+		static std::vector<QMod *> FindQMods(QModField field, std::string_view value, bool prefix = false)
+		{
+			std::shared_ptr<const Registry> registry = std::atomic_load(&DownloadedQMods);
+			std::vector<QMod *> matches;
+
+			auto search = registry->indexes.find(field);
+			if (search == registry->indexes.end())
+				return matches;
+
+			const QModIndex &index = search->second;
+
+			// Everything that starts with the value comes straight after it, as the index is sorted
+			for (auto it = index.lower_bound(value); it != index.end(); it++)
+			{
+				std::string_view key = it->first;
+				if (prefix ? !key.starts_with(value) : key != value)
+					break;
+
+				if (std::find(matches.begin(), matches.end(), it->second) == matches.end())
+					matches.push_back(it->second);
+			}
+
+			return matches;
+		}
+
+		/**
+		 * @brief Gets every downloaded QMod that's a core mod, keyed by ID
+		 * @details Like GetDownloadedQMods, this is a snapshot that's safe to read from any thread
+		 *
+		 * @return The core QMods
+		 */
+		static std::shared_ptr<const QModMap> GetCoreQMods()
+		{
+			return std::atomic_load(&CoreQMods);
+		}
+
+		// Marks a downloaded QMod as being one of the core mods
+		static void AddCoreQMod(QMod *qmod)
+		{
+			UpdateRegistry(CoreQMods, [qmod](QModMap &qmods) { qmods.insert({qmod->m_Id, qmod}); });
+		}
+
+		// Forgets every downloaded QMod, without uninstalling or deleting anything
+		static void ClearDownloadedQMods()
+		{
+			UpdateRegistry(DownloadedQMods, [](Registry &registry) { registry = Registry(); });
+		}
+
+		// Replaces every downloaded QMod at once, without uninstalling or deleting anything. Every change copies the whole registry,
+		// so this is much cheaper than adding lots of QMods one at a time
+		static void SetDownloadedQMods(const std::vector<QMod *> &qmods)
+		{
+			std::shared_ptr<Registry> registry = std::make_shared<Registry>();
+
+			for (QMod *qmod : qmods)
+				registry->Add(qmod);
+
+			std::unique_lock guard(RegistryLock);
+			std::atomic_store(&DownloadedQMods, std::shared_ptr<const Registry>(std::move(registry)));
+		}
 
 		static QMod *GetDownloadedQMod(std::string id)
 		{
-			auto search = DownloadedQMods->find(id);
-			if (search != DownloadedQMods->end())
+			std::shared_ptr<const QModMap> downloadedQMods = GetDownloadedQMods();
+
+			auto search = downloadedQMods->find(id);
+			if (search != downloadedQMods->end())
 				return search->second;
 
 			return nullptr;
@@ -440,16 +586,137 @@ namespace ModloaderUtils
 		}
 
 		const bool IsCoreMod() {
-			for (std::pair<std::string, QMod*> coreQModPair : *CoreQMods) {
-				if (coreQModPair.first == m_Id) return true;
-			}
+			return GetCoreQMods()->contains(m_Id);
+		}
 
-			return false;
+		/**
+		 * @brief Checks if this QMod matches a filter, without copying anything
+		 *
+		 * @param filter The filter to check against
+		 * @return Returns true if this QMod matches every part of the filter
+		 */
+		const bool Matches(const QModFilter &filter)
+		{
+			if (filter.installed.has_value() && m_Installed != *filter.installed)
+				return false;
+
+			if (filter.core.has_value() && IsCoreMod() != *filter.core)
+				return false;
+
+			if (!filter.packageId.empty() && m_PackageId != filter.packageId)
+				return false;
+
+			return true;
 		}
 
 	private:
+		// Readers load a snapshot without locking. Writers copy the current snapshot, change the copy and then publish it, holding RegistryLock so two writers cant lose each other's changes
+		inline static std::mutex RegistryLock;
+
+		// Sorted, so every key that starts with a prefix is next to each other
+		using QModIndex = std::multimap<std::string, QMod *, std::less<>>;
+
+		struct Registry
+		{
+			QModMap qmods;
+			std::map<QModField, QModIndex> indexes;
+
+			void Add(QMod *qmod)
+			{
+				if (!qmods.insert({qmod->m_Id, qmod}).second)
+					return;
+
+				qmod->ForEachIndexKey([&](QModField field, const std::string &key) { indexes[field].insert({key, qmod}); });
+			}
+
+			void Remove(const std::string &id)
+			{
+				auto search = qmods.find(id);
+				if (search == qmods.end())
+					return;
+
+				QMod *qmod = search->second;
+				qmods.erase(search);
+
+				qmod->ForEachIndexKey([&](QModField field, const std::string &key)
+				{
+					QModIndex &index = indexes[field];
+					auto range = index.equal_range(key);
+
+					for (auto it = range.first; it != range.second; it++)
+					{
+						if (it->second == qmod)
+						{
+							index.erase(it);
+							break;
+						}
+					}
+				});
+			}
+		};
+
+		inline static std::shared_ptr<const Registry> DownloadedQMods = std::make_shared<const Registry>();
+		inline static std::shared_ptr<const QModMap> CoreQMods = std::make_shared<const QModMap>();
+
+		template <typename T, typename Func>
+		static void UpdateRegistry(std::shared_ptr<const T> &registry, Func &&update)
+		{
+			std::unique_lock guard(RegistryLock);
+
+			std::shared_ptr<T> newRegistry = std::make_shared<T>(*std::atomic_load(&registry));
+			update(*newRegistry);
+
+			std::atomic_store(&registry, std::shared_ptr<const T>(std::move(newRegistry)));
+		}
+
+		// Calls func(field, key) for every key this QMod is indexed by in the registry
+		template <typename Func>
+		void ForEachIndexKey(Func &&func)
+		{
+			func(QModField::Author, m_Author);
+			func(QModField::PackageId, m_PackageId);
+			func(QModField::PackageVersion, m_PackageVersion);
+
+			for (const std::string &libraryFile : *m_LibraryFiles)
+				func(QModField::LibraryFile, libraryFile);
+
+			for (const FileCopy &fileCopy : *m_FileCopies)
+				func(QModField::FileCopyDestination, fileCopy.destination);
+		}
+
 		inline static std::mutex InstallLock;
 		inline static std::mutex BmbfConfigLock;
+
+		// m_Path is only changed while holding both this and InstallLock, so anything already holding InstallLock can read it without this
+		inline static std::mutex PathLock;
+
+		// Dependencies that are being downloaded and installed right now, keyed by ID, so the same one is never downloaded twice at once.
+		// The future is only ready once the dependency is installed, or has failed to download or install
+		struct InFlightDependency
+		{
+			std::shared_future<QMod *> result;
+
+			// The QMod whose install is downloading it
+			QMod *downloader;
+		};
+
+		inline static std::mutex InFlightDependenciesLock;
+		inline static std::unordered_map<std::string, InFlightDependency> InFlightDependencies;
+
+		// QMods that are being installed right now, so anything that needs one of them installed can wait for it to actually finish
+		struct InFlightInstall
+		{
+			std::shared_ptr<std::promise<bool>> promise;
+			std::shared_future<bool> result;
+		};
+
+		inline static std::mutex InFlightInstallsLock;
+		inline static std::unordered_map<QMod *, InFlightInstall> InFlightInstalls;
+
+		// The install that each in-flight install cant finish without. Branches only catch recursive dependencies on one thread,
+		// so this catches the ones that span threads, like two mods that depend on eachother being installed in the same batch
+		inline static std::mutex WaitingOnLock;
+		inline static std::unordered_map<QMod *, QMod *> WaitingOn;
 		inline static std::string AppPackageId = "";
 
 		void CollectBMBFData(bool verbos = true)
@@ -502,99 +769,359 @@ namespace ModloaderUtils
 			}
 		}
 
-		void ExtractQMod()
+		bool ExtractQMod()
 		{
-			std::string tmpDir = GetTempDir(m_Path);
-			std::string modsExtractionPath = tmpDir + "Mods/";
-			std::string libsExtractionPath = tmpDir + "Libs/";
-			std::string fileCopiesExtractionPath = tmpDir + "FileCopies/";
+			// Open the archive once, and share it between all of the extraction jobs
+			ZipUtils::ZipArchive archive(m_Path);
+			if (!archive.Valid())
+			{
+				getLogger().error("Failed to open \"%s\" for extraction!", m_Path.c_str());
+				return false;
+			}
+
+			// Mods and Libs can be restored from the artifact store, File Copies are always extracted
+			struct ExtractionJob
+			{
+				std::string entryName;
+				std::string destination;
+				bool storable;
+			};
 
-			// Create dirs
-			std::system(string_format("mkdir -p \"%s\"", modsExtractionPath.c_str()).c_str());
-			std::system(string_format("mkdir -p \"%s\"", libsExtractionPath.c_str()).c_str());
-			std::system(string_format("mkdir -p \"%s\"", fileCopiesExtractionPath.c_str()).c_str());
+			std::vector<ExtractionJob> extractionJobs;
 
-			// Extract Mods
+			// Every file is extracted straight to where it's installed, so nothing is written twice
 			for (std::string mod : *m_ModFiles)
+				extractionJobs.push_back({mod, string_format("/sdcard/Android/data/com.beatgames.beatsaber/files/mods/%s", mod.c_str()), true});
+
+			for (std::string lib : *m_LibraryFiles)
+				extractionJobs.push_back({lib, string_format("/sdcard/Android/data/com.beatgames.beatsaber/files/libs/%s", lib.c_str()), true});
+
+			for (FileCopy fileCopy : *m_FileCopies)
+				extractionJobs.push_back({fileCopy.name, fileCopy.destination, false});
+
+			// Every entry is independent, so inflate them all at once across every core
+			std::atomic<bool> success = true;
+			std::atomic<int> skippedFiles = 0;
+			std::atomic<uint64_t> skippedBytes = 0;
+			std::atomic<int> restoredFiles = 0;
+
+			ThreadUtils::ParallelFor(extractionJobs.size(), [&](size_t i) {
+				auto &[entryName, destination, storable] = extractionJobs[i];
+
+				const ZipUtils::ZipEntry *entry = archive.FindEntry(entryName);
+				if (entry == nullptr)
+				{
+					getLogger().error("\"%s\" does not contain the file \"%s\"!", m_Id.c_str(), entryName.c_str());
+					success = false;
+					return;
+				}
+
+				// When reinstalling or upgrading, most files are usually identical to whats already installed, so dont rewrite them
+				if (HashUtils::FileMatches(destination, entry->uncompressedSize, entry->crc32))
+				{
+					skippedFiles++;
+					skippedBytes += entry->uncompressedSize;
+					return;
+				}
+
+				// If the QMod was disabled before, its files will still be in the store. Only the SHA-256 is trusted to say it's the same file,
+				// and working that out means inflating the entry, so the cheap size and CRC32 check goes first
+				if (storable && ArtifactStore::MightHaveArtifact(entry->uncompressedSize, entry->crc32))
+				{
+					std::optional<std::string> sha256 = archive.HashEntry(*entry);
+					if (sha256.has_value() && ArtifactStore::Restore(entry->uncompressedSize, entry->crc32, *sha256, destination))
+					{
+						restoredFiles++;
+						return;
+					}
+				}
+
+				if (!archive.ExtractEntry(*entry, destination))
+				{
+					getLogger().error("Failed to extract \"%s\" from \"%s\"!", entryName.c_str(), m_Id.c_str());
+					success = false;
+					return;
+				}
+
+				HashUtils::CacheFileCRC32(destination, entry->crc32);
+			});
+
+			if (restoredFiles > 0)
+				getLogger().info("Restored %i files from the artifact store while installing \"%s\"", restoredFiles.load(), m_Id.c_str());
+
+			if (skippedFiles > 0)
+				getLogger().info("Skipped %i unchanged files (%llu bytes) while installing \"%s\"", skippedFiles.load(), (unsigned long long)skippedBytes.load(), m_Id.c_str());
+
+			return success;
+		}
+
+		static void RemoveInstalledFile(const ZipUtils::ZipArchive &archive, std::string entryName, std::string path, bool stash)
+		{
+			const ZipUtils::ZipEntry *entry = archive.FindEntry(entryName);
+
+			if (entry == nullptr)
 			{
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), mod.c_str(), modsExtractionPath.c_str()).c_str());
+				unlink(path.c_str());
+				return;
 			}
 
-			// Extract Libs
-			for (std::string lib : *m_LibraryFiles)
+			if (stash)
 			{
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), lib.c_str(), libsExtractionPath.c_str()).c_str());
+				ArtifactStore::Stash(path, entry->uncompressedSize, entry->crc32);
+				return;
 			}
 
-			// Extract File Copies
-			for (FileCopy fileCopy : *m_FileCopies)
+			// The QMod is being removed completely, so theres no point keeping its files around
+			unlink(path.c_str());
+
+			if (ArtifactStore::MightHaveArtifact(entry->uncompressedSize, entry->crc32))
 			{
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), fileCopy.name.c_str(), fileCopiesExtractionPath.c_str()).c_str());
+				std::optional<std::string> sha256 = archive.HashEntry(*entry);
+				if (sha256.has_value())
+					ArtifactStore::Remove(entry->uncompressedSize, entry->crc32, *sha256);
 			}
 		}
 
-		bool PrepareDependency(Dependency dependency, std::vector<std::string> *installedInBranch)
+		// Tells ModIndex about every mod and lib file this QMod installs, after they've been added or removed
+		void UpdateModIndex()
 		{
-			getLogger().info("Preparing dependency of %s version %s", dependency.id.c_str(), dependency.version.c_str());
+			for (std::string modFile : *m_ModFiles)
+				ModIndex::Update(modFile, false);
 
-			// Try to see if there's a recurssive dependency
-			auto it = find(installedInBranch->begin(), installedInBranch->end(), dependency.id);
-			if (it != installedInBranch->end())
+			for (std::string libFile : *m_LibraryFiles)
+				ModIndex::Update(libFile, true);
+		}
+
+		// Checks that installing can even be tried, before any threads are started
+		bool CanInstall()
+		{
+			if (!m_Valid)
 			{
-				// Log the recursive error
-				int existingIndex = it - installedInBranch->begin();
-				std::string errorMsg = "";
+				getLogger().info("Mod \"%s\" Is an invalid QMod!", m_Id.c_str());
+				return false;
+			}
 
-				for (std::string mod : *installedInBranch)
-				{
-					errorMsg += string_format("\"%s\" -> ", mod.c_str());
-				}
-				errorMsg += dependency.id;
+			CollectAppPackageId();
+			if (m_PackageId != AppPackageId)
+			{
+				getLogger().info("Mod \"%s\" Is not built for the package \"%s\", but instead is built for \"%s\"!", m_Id.c_str(), AppPackageId.c_str(), m_PackageId.c_str());
+				return false;
+			}
 
-				getLogger().error("Recursive dependency detected: %s", errorMsg.c_str());
+			return true;
+		}
+
+		// Claims installing this QMod for the calling thread, and marks it as installed so nothing else tries to.
+		// If it's already installed or being installed, returns false and sets result to the outcome of that install instead
+		bool ClaimInstall(std::shared_future<bool> &result)
+		{
+			std::unique_lock guard(InFlightInstallsLock);
+
+			auto search = InFlightInstalls.find(this);
+			if (search != InFlightInstalls.end())
+			{
+				result = search->second.result;
+				return false;
+			}
+
+			if (m_Installed)
+			{
+				std::promise<bool> installed;
+				installed.set_value(true);
+
+				result = installed.get_future().share();
+				return false;
+			}
+
+			m_Installed = true;
+
+			std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+			result = promise->get_future().share();
+			InFlightInstalls.emplace(this, InFlightInstall{promise, result});
+
+			return true;
+		}
+
+		// Ends a claimed install, waking up anything waiting for it
+		void FinishInstall(bool success)
+		{
+			std::unique_lock guard(InFlightInstallsLock);
+
+			auto search = InFlightInstalls.find(this);
+			if (search == InFlightInstalls.end())
+				return;
+
+			if (!success)
+				m_Installed = false;
+
+			search->second.promise->set_value(success);
+			InFlightInstalls.erase(search);
+		}
+
+		// The first install stage, which gets every dependency installed. Returns false if there is nothing left to do, either because it failed or the mod is already installed
+		bool PrepareInstall(std::vector<std::string> *installedInBranch)
+		{
+			if (!m_Valid)
+			{
+				getLogger().info("Mod \"%s\" Is an invalid QMod!", m_Id.c_str());
 				return false;
 			}
 
-			QMod *existing = nullptr;
-			for (std::pair<std::string, QMod *> modPair : *DownloadedQMods)
+			std::shared_future<bool> inFlight;
+			if (!ClaimInstall(inFlight))
 			{
-				if (modPair.first == dependency.id)
+				getLogger().info("Mod \"%s\" Already Installed!", m_Id.c_str());
+				return false;
+			}
+
+			return PrepareClaimedInstall(installedInBranch);
+		}
+
+		// The rest of PrepareInstall, once this thread has claimed the install
+		bool PrepareClaimedInstall(std::vector<std::string> *installedInBranch)
+		{
+			// Add to the installed tree so that dependencies further down on us will trigger a recursive install error
+			installedInBranch->push_back(m_Id);
+
+			for (Dependency dependency : *m_Dependencies)
+			{
+				if (!PrepareDependency(dependency, installedInBranch))
 				{
-					existing = modPair.second;
+					getLogger().error("Failed to install \"%s\" as one of its dependencies (%s) also failed to install", m_Id.c_str(), dependency.id.c_str());
+
+					FinishInstall(false);
+					return false;
 				}
 			}
 
-			if (existing != nullptr)
+			return true;
+		}
+
+		// Records that this QMod's install cant finish until other's has. Returns false without recording anything if other's install is already waiting on this one,
+		// as waiting would never end
+		bool StartWaitingOn(QMod *other)
+		{
+			std::unique_lock guard(WaitingOnLock);
+
+			for (QMod *next = other; next != nullptr;)
 			{
-				if (semver::satisfies(existing->m_Version, dependency.version))
-				{
-					getLogger().info("Dependency is already downloaded and fits the version range \"%s\"", dependency.version.c_str());
+				if (next == this)
+					return false;
 
-					if (!existing->m_Installed)
-					{
-						getLogger().info("Installing Dependency...");
+				auto search = WaitingOn.find(next);
+				next = search != WaitingOn.end() ? search->second : nullptr;
+			}
 
-						std::optional<std::thread> thread = existing->InstallAsync(installedInBranch);
-						if (thread.has_value()) thread.value().join();
-					}
+			WaitingOn[this] = other;
+			return true;
+		}
 
-					return true;
-				}
+		void StopWaiting()
+		{
+			std::unique_lock guard(WaitingOnLock);
+			WaitingOn.erase(this);
+		}
 
-				if (dependency.downloadIfMissing == "")
+		// Installs this QMod on the calling thread, for dependent. If it's already being installed, this waits for that install to finish instead,
+		// so whatever depends on it is never installed before it is
+		bool InstallDependency(QMod *dependent, std::vector<std::string> *installedInBranch)
+		{
+			if (!CanInstall())
+				return false;
+
+			std::shared_future<bool> inFlight;
+			if (!ClaimInstall(inFlight))
+			{
+				if (inFlight.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+					return inFlight.get();
+
+				if (!dependent->StartWaitingOn(this))
 				{
-					getLogger().error("Dependency with ID \"%s\" is already installed but with an incorrect version (\"%s\" does not intersect \"%s\"). Upgrading was not possible as there was no download link provided", dependency.id.c_str(), existing->m_Version.c_str(), dependency.version.c_str());
+					getLogger().error("Recursive dependency detected: \"%s\" depends on \"%s\", which is being installed at the same time and depends back on \"%s\"", dependent->m_Id.c_str(), m_Id.c_str(), dependent->m_Id.c_str());
 					return false;
 				}
+
+				getLogger().info("Dependency \"%s\" is already being installed, waiting for it to finish...", m_Id.c_str());
+
+				bool installed = inFlight.get();
+				dependent->StopWaiting();
+
+				return installed;
 			}
-			else if (dependency.downloadIfMissing == "")
+
+			// We only just claimed it, so nothing can be waiting on it yet, let alone be waiting on dependent
+			dependent->StartWaitingOn(this);
+
+			bool installed = PrepareClaimedInstall(installedInBranch) && PlaceFiles(installedInBranch);
+			if (installed)
+				CommitInstall();
+
+			dependent->StopWaiting();
+			return installed;
+		}
+
+		// The second install stage, which extracts the QMod's files straight into their install locations
+		bool PlaceFiles(std::vector<std::string> *installedInBranch)
+		{
+			// We only lock now so that the dependencies can install first without issues
+			std::unique_lock guard(InstallLock);
+
+			// Even a failed extraction can leave some of the files behind
+			bool extracted = ExtractQMod();
+			UpdateModIndex();
+
+			if (!extracted)
 			{
-				getLogger().error("Dependency \"%s\" is not installed, and the mod depending on it does not specify a download path if missing", dependency.id.c_str());
+				getLogger().error("Failed to install \"%s\" as its files could not be extracted", m_Id.c_str());
+
+				FinishInstall(false);
 				return false;
 			}
 
-			// If we didnt return, then the correct dependency version isnt installed and we have a url, so we attempt to download it now
+			// BMBF expects Beat Saber QMods to be kept in its Mods folder
+			if (!strcmp(m_PackageId.c_str(), "com.beatgames.beatsaber"))
+			{
+				std::string bmbfPath = string_format("/sdcard/BMBFData/Mods/%s", GetFileName(m_Path, false).c_str());
+
+				if (m_Path != bmbfPath)
+				{
+					if (rename(m_Path.c_str(), bmbfPath.c_str()) != 0)
+						std::system(string_format("mv -f \"%s\" \"%s\"", m_Path.c_str(), bmbfPath.c_str()).c_str());
+
+					std::unique_lock pathGuard(PathLock);
+					m_Path = bmbfPath;
+				}
+			}
+
+			installedInBranch->erase(std::remove(installedInBranch->begin(), installedInBranch->end(), m_Id), installedInBranch->end());
+			return true;
+		}
 
+		// The last install stage. BMBF's config has its own lock, so this doesnt hold up anything else being installed
+		void CommitInstall()
+		{
+			// If QMod is for Beat Saber, then Update its BMBF Data
+			if (!strcmp(m_PackageId.c_str(), "com.beatgames.beatsaber"))
+			{
+				UpdateBMBFData();
+			}
+
+			getLogger().info("Successfully Installed \"%s\"!", m_Id.c_str());
+			FinishInstall(true);
+		}
+
+		static std::function<void(const TransferProgress &)> GetProgressReporter(std::string name)
+		{
+			if (!OnDownloadProgress)
+				return nullptr;
+
+			return [name](const TransferProgress &progress)
+			{ OnDownloadProgress(name, progress); };
+		}
+
+		// Downloads a dependency and checks its the mod the dependency asked for, without installing it
+		static QMod *DownloadDependency(const Dependency &dependency)
+		{
 			QMod *downloadedDependency = nullptr;
 			std::string downloadFileLoc = string_format("/sdcard/BMBFData/Mods/Temp/Downloads/%s", dependency.id.c_str());
 
@@ -602,10 +1129,10 @@ namespace ModloaderUtils
 			auto CleanupFunction = [&]()
 			{ CleanupTempDir(string_format("Downloads/%s", dependency.id.c_str()).c_str(), true); };
 
-			if (!WebUtils::DownloadFile(dependency.id, dependency.downloadIfMissing, downloadFileLoc))
+			if (!WebUtils::DownloadFile(dependency.id, dependency.downloadIfMissing, downloadFileLoc, RequestPriority::Normal, dependency.sha256, GetProgressReporter(dependency.id)))
 			{
 				CleanupFunction();
-				return false;
+				return nullptr;
 			}
 
 			downloadedDependency = new QMod(downloadFileLoc);
@@ -615,7 +1142,7 @@ namespace ModloaderUtils
 				getLogger().error("Failed to parse QMod for dependency \"%s\"", dependency.id.c_str());
 
 				CleanupFunction();
-				return false;
+				return nullptr;
 			}
 
 			// Sanity checks that the download link actually pointed to the right mod
@@ -624,7 +1151,7 @@ namespace ModloaderUtils
 				getLogger().error("Downloaded dependency had Id \"%s\", whereas the dependency stated ID \"%s\"", downloadedDependency->m_Id.c_str(), dependency.id.c_str());
 
 				CleanupFunction();
-				return false;
+				return nullptr;
 			}
 
 			if (!semver::satisfies(downloadedDependency->m_Version, dependency.version))
@@ -632,15 +1159,129 @@ namespace ModloaderUtils
 				getLogger().error("Downloaded dependency \"%s\" v%s was not within the version range stated in the dependency info (%s)", downloadedDependency->m_Id.c_str(), downloadedDependency->m_Version.c_str(), dependency.version.c_str());
 
 				CleanupFunction();
+				return nullptr;
+			}
+
+			return downloadedDependency;
+		}
+
+		bool PrepareDependency(Dependency dependency, std::vector<std::string> *installedInBranch)
+		{
+			getLogger().info("Preparing dependency of %s version %s", dependency.id.c_str(), dependency.version.c_str());
+
+			// Try to see if there's a recurssive dependency
+			auto it = find(installedInBranch->begin(), installedInBranch->end(), dependency.id);
+			if (it != installedInBranch->end())
+			{
+				// Log the recursive error
+				int existingIndex = it - installedInBranch->begin();
+				std::string errorMsg = "";
+
+				for (std::string mod : *installedInBranch)
+				{
+					errorMsg += string_format("\"%s\" -> ", mod.c_str());
+				}
+				errorMsg += dependency.id;
+
+				getLogger().error("Recursive dependency detected: %s", errorMsg.c_str());
+				return false;
+			}
+
+			QMod *existing = GetDownloadedQMod(dependency.id);
+
+			if (existing != nullptr)
+			{
+				if (semver::satisfies(existing->m_Version, dependency.version))
+				{
+					getLogger().info("Dependency is already downloaded and fits the version range \"%s\"", dependency.version.c_str());
+
+					// Returns straight away if it's already installed, or waits if something else is installing it right now
+					return existing->InstallDependency(this, installedInBranch);
+				}
+
+				if (dependency.downloadIfMissing == "")
+				{
+					getLogger().error("Dependency with ID \"%s\" is already installed but with an incorrect version (\"%s\" does not intersect \"%s\"). Upgrading was not possible as there was no download link provided", dependency.id.c_str(), existing->m_Version.c_str(), dependency.version.c_str());
+					return false;
+				}
+			}
+			else if (dependency.downloadIfMissing == "")
+			{
+				getLogger().error("Dependency \"%s\" is not installed, and the mod depending on it does not specify a download path if missing", dependency.id.c_str());
 				return false;
 			}
 
+			// If we didnt return, then the correct dependency version isnt installed and we have a url, so we attempt to download it now
+			// Other mods being installed at the same time might depend on it too, so only the first one to get here downloads and installs it, and the rest wait for that
+
+			std::promise<QMod *> promise;
+			InFlightDependency inFlight;
+			bool alreadyDownloading = false;
+
+			{
+				std::unique_lock guard(InFlightDependenciesLock);
+
+				auto search = InFlightDependencies.find(dependency.id);
+				alreadyDownloading = search != InFlightDependencies.end();
+
+				if (alreadyDownloading)
+				{
+					inFlight = search->second;
+				}
+				else
+				{
+					inFlight = {promise.get_future().share(), this};
+					InFlightDependencies.emplace(dependency.id, inFlight);
+				}
+			}
+
+			QMod *downloadedDependency = nullptr;
+
+			if (alreadyDownloading)
+			{
+				if (inFlight.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				{
+					// Whoever is downloading it might end up depending on us
+					if (!StartWaitingOn(inFlight.downloader))
+					{
+						getLogger().error("Recursive dependency detected: \"%s\" is being downloaded by \"%s\", which depends on \"%s\"", dependency.id.c_str(), inFlight.downloader->m_Id.c_str(), m_Id.c_str());
+						return false;
+					}
+
+					getLogger().info("Dependency \"%s\" is already being downloaded, waiting for it to finish...", dependency.id.c_str());
+					inFlight.result.wait();
+					StopWaiting();
+				}
+
+				downloadedDependency = inFlight.result.get();
+
+				if (downloadedDependency == nullptr)
+					return false;
+
+				// Whoever downloaded it might have asked for a different version range
+				if (!semver::satisfies(downloadedDependency->m_Version, dependency.version))
+				{
+					getLogger().error("Downloaded dependency \"%s\" v%s was not within the version range stated in the dependency info (%s)", downloadedDependency->m_Id.c_str(), downloadedDependency->m_Version.c_str(), dependency.version.c_str());
+					return false;
+				}
+
+				return true;
+			}
+
+			downloadedDependency = DownloadDependency(dependency);
+
 			// Everything's looking good, time to install!
 			// NOTE: There is no clean up here because the cleanup will occur during the install
-			std::optional<std::thread> thread = downloadedDependency->InstallAsync(installedInBranch);
-			if (thread.has_value()) thread.value().join();
+			bool installed = downloadedDependency != nullptr && downloadedDependency->InstallDependency(this, installedInBranch);
 
-			return true;
+			{
+				std::unique_lock guard(InFlightDependenciesLock);
+				InFlightDependencies.erase(dependency.id);
+			}
+
+			// Only now is it safe for anything else that depends on it to carry on
+			promise.set_value(installed ? downloadedDependency : nullptr);
+			return installed;
 		}
 
 		void UpdateBMBFJSONData(auto &mod, auto &allocator)
@@ -662,6 +1303,10 @@ namespace ModloaderUtils
 
 		void UpdateBMBFData(bool verbos = true)
 		{
+			// BMBF reads the cover straight from the Mods folder, so it has to be extracted before its name goes in the config.
+			// Nothing else needs the config while extracting it, so it's done before taking the lock
+			std::optional<std::string> coverPath = CoverImagePath();
+
 			// Prevents multiple threads writing to the file at the same time
 			std::unique_lock<std::mutex> guard(BmbfConfigLock);
 
@@ -682,27 +1327,15 @@ namespace ModloaderUtils
 			const auto &mods = document["Mods"].GetArray();
 			bool foundMod = false;
 
-			std::string fileName = GetFileName(m_Path, false);
-			std::string displayName = GetFileName(m_Path);
-
-			// Move QMod
-
-			std::system(string_format("mv -f \"%s\" \"/sdcard/BMBFData/Mods/%s\"", m_Path.c_str(), fileName.c_str()).c_str());
-			m_Path = string_format("/sdcard/BMBFData/Mods/%s", fileName.c_str()).c_str();
-
-			// Attempt To Install The Cover
-
-			if (m_CoverImage != "")
+			if (coverPath.has_value() || m_CoverImage == "")
 			{
-				std::string tmpDir = GetTempDir(m_Path);
-
-				std::system(string_format("mkdir -p \"%s\"", tmpDir.c_str()).c_str());
-
-				std::system(string_format("unzip \"%s\" \"%s\" -d \"%s\"", m_Path.c_str(), m_CoverImage.c_str(), tmpDir.c_str()).c_str());
+				std::string coverImageFilename = coverPath.has_value() ? GetFileName(*coverPath, false, true) : "";
 
-				std::system(string_format("mv -f \"%s/%s\" \"sdcard/BMBFData/Mods/%s_%s\"", tmpDir.c_str(), m_CoverImage.c_str(), displayName.c_str(), m_CoverImage.c_str()).c_str());
+				// Otherwise covers from older versions of this QMod would never get cleaned up
+				if (m_CoverImageFilename != "" && m_CoverImageFilename != coverImageFilename && m_CoverImageFilename.find('/') == std::string::npos)
+					unlink(string_format("/sdcard/BMBFData/Mods/%s", m_CoverImageFilename.c_str()).c_str());
 
-				m_CoverImageFilename = string_format("%s_%s", displayName.c_str(), m_CoverImage.c_str());
+				m_CoverImageFilename = coverImageFilename;
 			}
 
 			// Try Find Out Mod in the BMBF Data
@@ -815,6 +1448,12 @@ namespace ModloaderUtils
 				getLogger().info("Saved BMBF Data for \"%s\"!", m_Id.c_str());
 		}
 
+		const std::string GetCoverImageCachePath()
+		{
+			// Covers can be in sub folders in the QMod, but we only want the actual file name
+			return string_format("/sdcard/BMBFData/Mods/%s_%s", m_ArchiveHash.c_str(), GetFileName(m_CoverImage, false, true).c_str());
+		}
+
 		static void CollectAppPackageId()
 		{
 			if (AppPackageId == "")
@@ -890,6 +1529,7 @@ namespace ModloaderUtils
 		std::string m_PackageVersion;
 
 		std::string m_Path;
+		std::string m_ArchiveHash;
 
 		std::vector<std::string> *m_ModFiles;
 		std::vector<std::string> *m_LibraryFiles;
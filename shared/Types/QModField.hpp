@@ -0,0 +1,16 @@
+#pragma once
+
+namespace ModloaderUtils {
+	// The QMod fields that downloaded QMods are indexed by, for QMod::FindQMods
+	enum class QModField {
+		Author,
+		PackageId,
+		PackageVersion,
+
+		// Matches any of the QMod's library files
+		LibraryFile,
+
+		// Matches the destination of any of the QMod's file copies
+		FileCopyDestination
+	};
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace ModloaderUtils {
+	struct QModFilter {
+		// Only match QMods that are, or aren't, installed. Matches both if nullopt
+		std::optional<bool> installed;
+
+		// Only match QMods that are, or aren't, core mods. Matches both if nullopt
+		std::optional<bool> core;
+
+		// Only match QMods for this package, for example "com.beatgames.beatsaber". Matches every package if empty.
+		// Not copied, so whatever it points to has to outlive the filter
+		std::string_view packageId;
+	};
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "modloader-utils/shared/Types/QMod.hpp"
+#include "modloader-utils/shared/Types/QModFilter.hpp"
+
+#include <memory>
+#include <iterator>
+#include <cstddef>
+
+namespace ModloaderUtils {
+	/**
+	 * A filtered view over a snapshot of QMods, which is walked as it's iterated rather than copied into a new map.
+	 * The view keeps its snapshot alive, so it can be kept and iterated from any thread. QMods downloaded or removed after the snapshot was taken aren't included,
+	 * but the filter is checked as the view is iterated, so changes like a QMod being installed are always up to date
+	 */
+	class QModView {
+	public:
+		using QModMap = QMod::QModMap;
+
+		class Iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = QMod*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = QMod* const*;
+			using reference = QMod* const&;
+
+			Iterator() = default;
+
+			Iterator(QModMap::const_iterator current, QModMap::const_iterator end, QModFilter filter) : m_Current(current), m_End(end), m_Filter(filter) {
+				SkipUnmatched();
+			}
+
+			reference operator*() const { return m_Current->second; }
+			pointer operator->() const { return &m_Current->second; }
+
+			Iterator& operator++() {
+				++m_Current;
+				SkipUnmatched();
+
+				return *this;
+			}
+
+			Iterator operator++(int) {
+				Iterator previous = *this;
+				++*this;
+
+				return previous;
+			}
+
+			bool operator==(const Iterator& other) const { return m_Current == other.m_Current; }
+			bool operator!=(const Iterator& other) const { return m_Current != other.m_Current; }
+
+		private:
+			QModMap::const_iterator m_Current;
+			QModMap::const_iterator m_End;
+			QModFilter m_Filter;
+
+			void SkipUnmatched() {
+				while (m_Current != m_End && !m_Current->second->Matches(m_Filter)) ++m_Current;
+			}
+		};
+
+		QModView(std::shared_ptr<const QModMap> qmods, QModFilter filter = {}) : m_QMods(std::move(qmods)), m_Filter(filter) {}
+
+		Iterator begin() const { return Iterator(m_QMods->begin(), m_QMods->end(), m_Filter); }
+		Iterator end() const { return Iterator(m_QMods->end(), m_QMods->end(), m_Filter); }
+
+		bool empty() const { return begin() == end(); }
+
+		// Walks the whole map, so only call this when the count is actually needed
+		size_t size() const { return std::distance(begin(), end()); }
+
+	private:
+		std::shared_ptr<const QModMap> m_QMods;
+		QModFilter m_Filter;
+	};
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ModloaderUtils {
+	// Lets string keyed maps be searched with a std::string_view or const char* without making a std::string first
+	struct StringHash {
+		using is_transparent = void;
+
+		size_t operator()(std::string_view string) const { return std::hash<std::string_view>{}(string); }
+	};
+
+	template<typename T>
+	using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+	using StringSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+}
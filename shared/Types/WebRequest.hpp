@@ -0,0 +1,107 @@
+#pragma once
+
+#include "libcurl/shared/curl.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+namespace ModloaderUtils {
+	enum class RequestPriority {
+		Low,
+		Normal,
+		High
+	};
+
+	struct TransferProgress {
+		uint64_t bytesDone = 0;
+
+		// 0 if the server didnt say how big the response is
+		uint64_t bytesTotal = 0;
+
+		// Bytes per second since the last progress update, and since the transfer started
+		double currentRate = 0;
+		double averageRate = 0;
+	};
+
+	struct TransferStats {
+		// The host the response actually came from, after any redirects
+		std::string host;
+		uint64_t bytesReceived = 0;
+
+		// Seconds from the start of the request until each step was done. The connect and TLS times are 0 if an existing connection was reused
+		double connectTime = 0;
+		double tlsTime = 0;
+		double timeToFirstByte = 0;
+		double totalTime = 0;
+	};
+
+	struct HostStats {
+		uint64_t requests = 0;
+		uint64_t failedRequests = 0;
+		uint64_t newConnections = 0;
+		uint64_t bytesReceived = 0;
+
+		double totalConnectTime = 0;
+		double totalTlsTime = 0;
+		double totalTimeToFirstByte = 0;
+		double totalTime = 0;
+
+		const inline double AverageConnectTime() const { return newConnections > 0 ? totalConnectTime / newConnections : 0; }
+		const inline double AverageTlsTime() const { return newConnections > 0 ? totalTlsTime / newConnections : 0; }
+		const inline double AverageTimeToFirstByte() const { return requests > 0 ? totalTimeToFirstByte / requests : 0; }
+
+		// Bytes per second, over all the time spent on requests to this host
+		const inline double AverageRate() const { return totalTime > 0 ? bytesReceived / totalTime : 0; }
+	};
+
+	struct WebResponse {
+		CURLcode result = CURLE_OK;
+		long httpCode = 0;
+
+		// The headers of the final response, after any redirects. Names are lower case
+		std::unordered_map<std::string, std::string> headers;
+
+		// Timings from curl, which show if a slow request was waiting on the network or on us
+		TransferStats stats;
+
+		const inline bool Success() const { return result == CURLE_OK; }
+
+		const std::string GetHeader(std::string name) const
+		{
+			auto search = headers.find(name);
+			return search != headers.end() ? search->second : "";
+		}
+	};
+
+	struct WebRequest {
+		std::string url;
+		RequestPriority priority = RequestPriority::Normal;
+
+		// Extra headers to send, such as "Range: bytes=0-"
+		std::vector<std::string> headers;
+
+		// Treat HTTP error codes as a failed request, rather than passing the error page to onData
+		bool failOnError = true;
+
+		// Only fetch the headers, like a HEAD request. onData is never called
+		bool noBody = false;
+
+		// Let this request share a connection with other requests to the same host. Turning this off gives it a connection of its own, which is faster for big downloads over slow links
+		bool multiplex = true;
+
+		// Called on the engine thread once the response's headers have arrived, before any of the body. Return false to cancel the request
+		std::function<bool(const WebResponse &response)> onResponse;
+
+		// Called on the engine thread with each chunk of the body as it arrives. Return false to cancel the request
+		std::function<bool(const char *data, size_t size)> onData;
+
+		// Called on the engine thread every DownloadEngine::ProgressInterval while the body is downloading, and once more when it is done
+		std::function<void(const TransferProgress &progress)> onProgress;
+
+		// Called on the engine thread once the request has finished, whether it succeeded or not
+		std::function<void(WebResponse response)> onComplete;
+	};
+}
@@ -8,7 +8,32 @@
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/error/error.h"
 #include "beatsaber-hook/shared/rapidjson/include/rapidjson/error/en.h"
 
+#include "modloader-utils/shared/FileUtils.hpp"
+#include "modloader-utils/shared/DownloadEngine.hpp"
+#include "modloader-utils/shared/HttpCache.hpp"
+#include "modloader-utils/shared/HashUtils.hpp"
+#include "modloader-utils/shared/Types/WebRequest.hpp"
+#include "modloader-utils/shared/Types/DownloadResult.hpp"
+
 #include <string>
+#include <vector>
+#include <optional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <cstdlib>
+#include <cctype>
+#include <functional>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 namespace ModloaderUtils {
 	namespace WebUtils {
@@ -26,82 +51,729 @@ namespace ModloaderUtils {
 			return newLength;
 		}
 
-		inline bool DownloadFile(std::string fileName, std::string url, std::string downloadFileLoc) {
-			CURL* curl = curl_easy_init();
-			std::string val;
+		// How much of a download is written between saving its progress, in case it gets interrupted
+		inline uint64_t DownloadCheckpointInterval = 4 * 1024 * 1024;
+
+		// Files at least this big are downloaded in several pieces at once, if the server allows it. 0 turns this off.
+		// Finding out if the server allows it costs a HEAD request, so that's only done when the size is already roughly known, from an old cached copy or a size hint
+		inline uint64_t SegmentedDownloadThreshold = 16 * 1024 * 1024;
 
-			if (curl) {
-				getLogger().info("Downloading file \"%s\"", fileName.c_str());
-				
-				CURLcode res;
+		// How many pieces a segmented download is split into
+		inline size_t DownloadSegmentCount = 4;
 
-				std::system("mkdir -p \"/sdcard/BMBFData/Mods/Temp/Downloads/\"");
+		// Private shit dont use >:(
 
-				curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-				curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteData);
-				curl_easy_setopt(curl, CURLOPT_WRITEDATA, &val);
-				curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false);
+		struct SegmentProgress {
+			uint64_t start;
+			uint64_t length;
+			uint64_t written;
+		};
 
-				// Follow HTTP redirects if necessary.
-                curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+		struct PartialDownload {
+			std::string url;
+			std::string etag;
+			std::string lastModified;
+			uint64_t offset = 0;
+
+			// Only used by segmented downloads, which dont fill the file in order. offset stays 0 for them
+			uint64_t size = 0;
+			std::vector<SegmentProgress> segments;
+
+			// Weak ETags can't be used with If-Range, so we can only resume with a strong ETag or a Last-Modified date
+			const std::string GetValidator() const {
+				if (!etag.empty() && !etag.starts_with("W/")) return etag;
+				return lastModified;
+			}
+		};
 
-				res = curl_easy_perform(curl);
-				curl_easy_cleanup(curl);
+		inline std::optional<PartialDownload> ReadPartialDownload(std::string statePath) {
+			std::ifstream stateFile(statePath);
+			if (!stateFile.good()) return std::nullopt;
 
-				if (res != CURLE_OK) {
-					getLogger().error("Curl Failed to download \"%s\" from Url \"%s\"! Error: (%i) %s", fileName.c_str(),url.c_str(), res, curl_easy_strerror(res));
+			std::stringstream stateJson;
+			stateJson << stateFile.rdbuf();
 
-					return false;
+			rapidjson::Document document;
+			if (document.Parse(stateJson.str().c_str()).HasParseError() || !document.IsObject()) return std::nullopt;
+
+			PartialDownload state;
+			if (document.HasMember("url") && document["url"].IsString()) state.url = document["url"].GetString();
+			if (document.HasMember("etag") && document["etag"].IsString()) state.etag = document["etag"].GetString();
+			if (document.HasMember("lastModified") && document["lastModified"].IsString()) state.lastModified = document["lastModified"].GetString();
+			if (document.HasMember("offset") && document["offset"].IsUint64()) state.offset = document["offset"].GetUint64();
+			if (document.HasMember("size") && document["size"].IsUint64()) state.size = document["size"].GetUint64();
+
+			if (document.HasMember("segments") && document["segments"].IsArray()) {
+				for (const rapidjson::Value& segment : document["segments"].GetArray()) {
+					if (!segment.IsObject() || !segment.HasMember("start") || !segment.HasMember("length") || !segment.HasMember("written")) return std::nullopt;
+					if (!segment["start"].IsUint64() || !segment["length"].IsUint64() || !segment["written"].IsUint64()) return std::nullopt;
+
+					SegmentProgress progress{segment["start"].GetUint64(), segment["length"].GetUint64(), segment["written"].GetUint64()};
+					if (progress.written > progress.length || progress.start + progress.length > state.size) return std::nullopt;
+
+					state.segments.push_back(progress);
 				}
+			}
+
+			return state;
+		}
+
+		inline bool WritePartialDownload(std::string statePath, const PartialDownload& state) {
+			rapidjson::StringBuffer buffer;
+			rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+			writer.StartObject();
+			writer.Key("url");
+			writer.String(state.url.c_str());
+			writer.Key("etag");
+			writer.String(state.etag.c_str());
+			writer.Key("lastModified");
+			writer.String(state.lastModified.c_str());
+			writer.Key("offset");
+			writer.Uint64(state.offset);
+			writer.Key("size");
+			writer.Uint64(state.size);
+
+			writer.Key("segments");
+			writer.StartArray();
+
+			for (const SegmentProgress& segment : state.segments) {
+				writer.StartObject();
+				writer.Key("start");
+				writer.Uint64(segment.start);
+				writer.Key("length");
+				writer.Uint64(segment.length);
+				writer.Key("written");
+				writer.Uint64(segment.written);
+				writer.EndObject();
+			}
+
+			writer.EndArray();
+			writer.EndObject();
+
+			FileUtils::AtomicFile file(statePath);
+			return file.Write(buffer.GetString(), buffer.GetSize()) && file.Commit();
+		}
+
+		struct DownloadSegment {
+			uint64_t start;
+			uint64_t length;
+			uint64_t written = 0;
+
+			// What was already written before this attempt, so progress counts it too
+			uint64_t resumedFrom = 0;
+
+			TransferProgress progress;
+		};
 
-				std::ofstream file(downloadFileLoc);
-				file << val;
-				file.close();
+		// Downloads the file into fd in several pieces at once, carrying on from state.segments if it has any.
+		// Returns nullopt if the file should be downloaded in a single stream instead, because its too small, the server cant send it in pieces, or it changed since the pieces were started.
+		// Returns false if the download failed, in which case the progress is saved to statePath so the next attempt can carry on
+		inline std::optional<bool> DownloadSegments(std::string fileName, std::string url, int fd, std::string statePath, PartialDownload& state, uint64_t sizeHint, RequestPriority priority, const std::function<void(const TransferProgress&)>& onProgress) {
+			if (SegmentedDownloadThreshold == 0 || DownloadSegmentCount < 2) return std::nullopt;
+
+			std::vector<DownloadSegment> segments;
+			uint64_t size = state.size;
+			std::string validator = state.GetValidator();
+
+			if (!state.segments.empty()) {
+				getLogger().info("Resuming segmented download of \"%s\"", fileName.c_str());
+
+				for (const SegmentProgress& segment : state.segments) {
+					segments.push_back({segment.start, segment.length, segment.written, segment.written, {}});
+				}
 			} else {
-				getLogger().error("Curl failed to initialize for file \"%s\". No futher info was given", fileName.c_str());
-				return false;
+				// Most files are nowhere near big enough to split up, so dont spend a round trip finding out unless we have a reason to think this one is
+				if (sizeHint < SegmentedDownloadThreshold) return std::nullopt;
+
+				WebRequest probe;
+				probe.url = url;
+				probe.priority = priority;
+				probe.noBody = true;
+
+				WebResponse probeResponse = DownloadEngine::Get().SubmitAsync(std::move(probe)).get();
+				if (!probeResponse.Success()) return std::nullopt;
+
+				std::string contentLength = probeResponse.GetHeader("content-length");
+				if (probeResponse.GetHeader("accept-ranges") != "bytes" || contentLength.empty()) return std::nullopt;
+
+				size = strtoull(contentLength.c_str(), nullptr, 10);
+				if (size < SegmentedDownloadThreshold) return std::nullopt;
+
+				// Without something for If-Range to check, we couldn't tell if the file changed between fetching one piece and the next
+				state.etag = probeResponse.GetHeader("etag");
+				state.lastModified = probeResponse.GetHeader("last-modified");
+				state.size = size;
+
+				validator = state.GetValidator();
+				if (validator.empty()) return std::nullopt;
+
+				// Reserve all the space up front, so we find out now if it doesnt fit, and the pieces dont fragment the file
+				int allocateError = posix_fallocate(fd, 0, size);
+				if (allocateError == ENOSPC || ftruncate(fd, size) != 0) {
+					getLogger().error("Not enough space to download \"%s\" (%llu bytes)", fileName.c_str(), (unsigned long long)size);
+					return std::nullopt;
+				}
+
+				uint64_t segmentSize = (size + DownloadSegmentCount - 1) / DownloadSegmentCount;
+
+				for (uint64_t start = 0; start < size; start += segmentSize) {
+					segments.push_back({start, std::min(segmentSize, size - start), 0, 0, {}});
+				}
+
+				getLogger().info("Downloading \"%s\" in %lu segments", fileName.c_str(), segments.size());
+			}
+
+			// Saves how far every segment has got. Only called on the engine thread while the segments are downloading
+			auto SaveProgress = [&]() {
+				if (fdatasync(fd) != 0) return false;
+
+				state.segments.clear();
+				for (const DownloadSegment& segment : segments) {
+					state.segments.push_back({segment.start, segment.length, segment.written});
+				}
+
+				return WritePartialDownload(statePath, state);
+			};
+
+			// If the file changed on the server, every segment stops straight away as nothing they download is any use.
+			// If a segment just fails, the others carry on, as everything they get is saved for next time. Only touched on the engine thread
+			bool changed = false;
+			uint64_t uncheckpointedBytes = 0;
+
+			std::vector<std::future<WebResponse>> responses;
+
+			for (DownloadSegment& segment : segments) {
+				// Segments that finished last time dont need asking for again
+				if (segment.written == segment.length) continue;
+
+				uint64_t rangeStart = segment.start + segment.written;
+
+				WebRequest request;
+				request.url = url;
+				request.priority = priority;
+				request.multiplex = false;
+
+				request.headers.push_back("Range: bytes=" + std::to_string(rangeStart) + "-" + std::to_string(segment.start + segment.length - 1));
+				request.headers.push_back("If-Range: " + validator);
+
+				request.onResponse = [&changed, rangeStart](const WebResponse& response) {
+					// Anything other than exactly the range we asked for means the file changed, or the server ignored the range
+					if (changed || response.httpCode != 206 || !response.GetHeader("content-range").starts_with("bytes " + std::to_string(rangeStart) + "-")) {
+						changed = true;
+						return false;
+					}
+
+					return true;
+				};
+
+				request.onData = [&, fd](const char* data, size_t size) {
+					if (changed || segment.written + size > segment.length || !FileUtils::WriteAllAt(fd, data, size, segment.start + segment.written)) return false;
+
+					segment.written += size;
+					uncheckpointedBytes += size;
+
+					if (uncheckpointedBytes >= DownloadCheckpointInterval) {
+						SaveProgress();
+						uncheckpointedBytes = 0;
+					}
+
+					return true;
+				};
+
+				if (onProgress) {
+					// Every segment runs on the engine thread, so they can all be added up without a lock
+					request.onProgress = [&segments, &segment, &onProgress, size](const TransferProgress& progress) {
+						segment.progress = progress;
+						TransferProgress total{0, size, 0, 0};
+
+						for (const DownloadSegment& other : segments) {
+							total.bytesDone += other.resumedFrom + other.progress.bytesDone;
+							total.currentRate += other.progress.currentRate;
+							total.averageRate += other.progress.averageRate;
+						}
+
+						onProgress(total);
+					};
+				}
+
+				responses.push_back(DownloadEngine::Get().SubmitAsync(std::move(request)));
+			}
+
+			bool success = true;
+
+			for (std::future<WebResponse>& response : responses) {
+				success = response.get().Success() && success;
+			}
+
+			for (const DownloadSegment& segment : segments) {
+				success = success && segment.written == segment.length;
+			}
+
+			if (success) return true;
+
+			if (changed) {
+				getLogger().warning("\"%s\" changed on the server during its segmented download, downloading it again in a single stream...", fileName.c_str());
+
+				unlink(statePath.c_str());
+				return std::nullopt;
+			}
+
+			// Every segment has stopped by now, so the progress can be saved from here
+			if (!SaveProgress()) unlink(statePath.c_str());
+
+			getLogger().error("Segmented download of \"%s\" failed, it will carry on from where it stopped next time", fileName.c_str());
+			return false;
+		}
+
+		// Asks the server if a cached file is still current, without downloading it again if it isnt
+		inline bool IsCacheCurrent(const HttpCache::CacheEntry& entry, RequestPriority priority) {
+			std::vector<std::string> headers = HttpCache::GetRevalidationHeaders(entry);
+			if (headers.empty()) return false;
+
+			WebRequest request;
+			request.url = entry.url;
+			request.priority = priority;
+			request.noBody = true;
+			request.headers = std::move(headers);
+
+			WebResponse response = DownloadEngine::Get().SubmitAsync(std::move(request)).get();
+			return response.Success() && response.httpCode == 304;
+		}
+
+		struct DownloadHash {
+			uint64_t size = 0;
+			uint32_t crc32 = 0;
+			HashUtils::SHA256 sha256;
+
+			void Update(const void* data, size_t length) {
+				size += length;
+				crc32 = HashUtils::CRC32(crc32, data, length);
+				sha256.Update(data, length);
+			}
+
+			void Reset() {
+				size = 0;
+				crc32 = 0;
+				sha256.Reset();
+			}
+		};
+
+		// Hashes the first part of a file that is already on disk, such as what was downloaded before a download was resumed
+		inline bool HashFilePrefix(int fd, uint64_t length, DownloadHash& hash) {
+			constexpr size_t bufferSize = 256 * 1024;
+			std::unique_ptr<char[]> buffer(new char[bufferSize]);
+
+			while (hash.size < length) {
+				ssize_t bytesRead = pread(fd, buffer.get(), std::min((uint64_t)bufferSize, length - hash.size), hash.size);
+				if (bytesRead < 0 && errno == EINTR) continue;
+				if (bytesRead <= 0) return false;
+
+				hash.Update(buffer.get(), bytesRead);
 			}
 
 			return true;
 		}
 
-		inline std::string GetData(std::string url) {
-			CURL* curl = curl_easy_init();
-			std::string val;
+		inline bool DigestMatches(std::string expected, std::string actual) {
+			std::transform(expected.begin(), expected.end(), expected.begin(), ::tolower);
+			return expected == actual;
+		}
+
+		// Does the actual downloading for DownloadFile, without checking if someone else is already downloading the same url
+		inline DownloadResult FetchFile(std::string fileName, std::string url, std::string downloadFileLoc, RequestPriority priority, std::string expectedSHA256, const std::function<void(const TransferProgress&)>& onProgress, uint64_t sizeHint) {
+			getLogger().info("Downloading file \"%s\"", fileName.c_str());
+
+			std::optional<HttpCache::CacheEntry> cached = HttpCache::Lookup(url);
+
+			// The server only gets asked if theres no other way of knowing the cached copy is still the right one
+			auto CanUseCached = [&]() {
+				if (HttpCache::OfflineMode || HttpCache::IsFresh(*cached)) return true;
+
+				// If we know exactly which file we want, it doesnt matter what the server has now
+				if (!expectedSHA256.empty() && !cached->sha256.empty() && DigestMatches(expectedSHA256, cached->sha256)) return true;
+
+				if (!IsCacheCurrent(*cached, priority)) return false;
 
-			if (curl) {
-				getLogger().info("Getting data from \"%s\"", url.c_str());
-				
-				CURLcode res;
+				HttpCache::MarkValidated(*cached);
+				return true;
+			};
 
-				curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-				curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteData);
-				curl_easy_setopt(curl, CURLOPT_WRITEDATA, &val);
-				curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false);
+			if (cached.has_value() && CanUseCached() && HttpCache::CopyBody(*cached, downloadFileLoc)) {
+				DownloadResult result{true, cached->size, cached->crc32, cached->sha256};
 
-				// Follow HTTP redirects if necessary.
-                curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+				// Files that were cached before their hashes were known have to be read to get them
+				if (result.sha256.empty()) {
+					DownloadHash hash;
+					int fd = open(downloadFileLoc.c_str(), O_RDONLY | O_CLOEXEC);
 
-				curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
+					if (fd >= 0 && HashFilePrefix(fd, cached->size, hash)) {
+						result.crc32 = hash.crc32;
+						result.sha256 = hash.sha256.HexDigest();
+					}
 
-				res = curl_easy_perform(curl);
-				curl_easy_cleanup(curl);
+					if (fd >= 0) close(fd);
+				}
 
-				if (res != CURLE_OK) {
-					getLogger().error("Curl Failed to Get from Url \"%s\"! Error: (%i) %s", url.c_str(), res, curl_easy_strerror(res));
+				if (expectedSHA256.empty() || DigestMatches(expectedSHA256, result.sha256)) {
+					getLogger().info("Using cached copy of \"%s\"", fileName.c_str());
+					HttpCache::Touch(*cached);
 
-					return "";
+					return result;
 				}
+
+				getLogger().warning("Cached copy of \"%s\" does not have the expected SHA-256, downloading it again...", fileName.c_str());
+				HttpCache::Remove(url);
+				unlink(downloadFileLoc.c_str());
+			}
+
+			if (HttpCache::OfflineMode) {
+				getLogger().error("Cannot download \"%s\" in offline mode, as it isnt cached", fileName.c_str());
+				return {};
+			}
+
+			// A new version of a file is usually about as big as the old one
+			if (sizeHint == 0 && cached.has_value()) sizeHint = cached->size;
+
+			std::string partPath = downloadFileLoc + ".part";
+			std::string statePath = downloadFileLoc + ".part.json";
+
+			int fd = FileUtils::MakeDirs(FileUtils::GetParentDir(partPath)) ? open(partPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644) : -1;
+			if (fd < 0) {
+				getLogger().error("Failed to create a file to download \"%s\" to at \"%s\"", fileName.c_str(), partPath.c_str());
+				return {};
+			}
+
+			PartialDownload state;
+			state.url = url;
+
+			std::optional<PartialDownload> existingState = ReadPartialDownload(statePath);
+			struct stat partStat;
+
+			if (existingState.has_value() && existingState->url == url && !existingState->GetValidator().empty() && fstat(fd, &partStat) == 0) {
+				bool streamed = existingState->offset > 0 && (uint64_t)partStat.st_size >= existingState->offset;
+				bool segmented = existingState->offset == 0 && !existingState->segments.empty() && (uint64_t)partStat.st_size == existingState->size;
+
+				if (streamed || segmented) state = *existingState;
+			}
+
+			// The file is hashed as it is written, so it never has to be read back. Only what was downloaded before a resume has to be
+			DownloadHash hash;
+
+			// Segmented downloads are spread through the whole file, so only a streamed one can be cut short.
+			// Anything after the last saved offset might not have made it to storage, so we cant trust it
+			if (state.segments.empty()) {
+				if (ftruncate(fd, state.offset) != 0 || lseek(fd, state.offset, SEEK_SET) < 0) state.offset = 0;
+				if (state.offset > 0 && !HashFilePrefix(fd, state.offset, hash)) state.offset = 0;
+			}
+
+			bool success = true;
+
+			// Big files can be fetched in several pieces at once instead, but only when starting from scratch or carrying on a segmented download
+			std::optional<bool> segmented = state.offset == 0 ? DownloadSegments(fileName, url, fd, statePath, state, sizeHint, priority, onProgress) : std::nullopt;
+
+			if (segmented.has_value() && !*segmented) {
+				close(fd);
+				return {};
+			}
+
+			if (segmented.has_value()) {
+				// The pieces arrive out of order, so they can only be hashed once theyre all in
+				success = fstat(fd, &partStat) == 0 && HashFilePrefix(fd, partStat.st_size, hash);
 			} else {
-				getLogger().error("Curl failed to initialize for url \"%s\". No futher info was given", url.c_str());
+				// Whatever segments there were arent being carried on with, so they mustnt end up in the saved state
+				state.size = 0;
+				state.segments.clear();
+
+				WebRequest request;
+				request.url = url;
+				request.priority = priority;
+
+				if (state.offset > 0) {
+					getLogger().info("Resuming download of \"%s\" from byte %llu", fileName.c_str(), (unsigned long long)state.offset);
+
+					// If-Range makes the server send the whole file instead if it has changed since we started
+					request.headers.push_back("Range: bytes=" + std::to_string(state.offset) + "-");
+					request.headers.push_back("If-Range: " + state.GetValidator());
+				}
+
+				uint64_t uncheckpointedBytes = 0;
+				bool receivedResponse = false;
+				bool wrongRange = false;
+
+				// Progress counts what was downloaded before resuming too, unless the server makes us start again
+				uint64_t resumedFrom = state.offset;
+
+				if (onProgress) {
+					request.onProgress = [&](const TransferProgress& progress) {
+						TransferProgress total = progress;
+						total.bytesDone += resumedFrom;
+						if (total.bytesTotal > 0) total.bytesTotal += resumedFrom;
+
+						onProgress(total);
+					};
+				}
+
+				request.onResponse = [&](const WebResponse& response) {
+					receivedResponse = true;
+
+					if (response.httpCode == 206 && state.offset > 0) {
+						if (response.GetHeader("content-range").starts_with("bytes " + std::to_string(state.offset) + "-")) return true;
+
+						// Some servers and proxies send a different range to the one we asked for, which would corrupt the file if we appended it
+						getLogger().warning("Could not resume downloading \"%s\", as the server sent the wrong range. Starting again...", fileName.c_str());
+						wrongRange = true;
+						return false;
+					}
+
+					if (state.offset > 0)
+						getLogger().info("Could not resume downloading \"%s\", as the server sent the whole file. Starting again...", fileName.c_str());
+
+					state.offset = 0;
+					state.etag = response.GetHeader("etag");
+					state.lastModified = response.GetHeader("last-modified");
+					hash.Reset();
+					resumedFrom = 0;
+
+					return ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0;
+				};
+
+				request.onData = [&](const char* data, size_t size) {
+					if (!FileUtils::WriteAll(fd, data, size)) {
+						getLogger().critical("Failed to write %lu bytes to \"%s\"", size, partPath.c_str());
+						return false;
+					}
+
+					hash.Update(data, size);
+					state.offset += size;
+					uncheckpointedBytes += size;
+
+					if (uncheckpointedBytes >= DownloadCheckpointInterval) {
+						// Make sure the data is actually stored before we say it is
+						if (fdatasync(fd) == 0) WritePartialDownload(statePath, state);
+						uncheckpointedBytes = 0;
+					}
+
+					return true;
+				};
+
+				WebResponse response = DownloadEngine::Get().SubmitAsync(std::move(request)).get();
+
+				if (wrongRange) {
+					close(fd);
+					unlink(partPath.c_str());
+					unlink(statePath.c_str());
+
+					// Theres no partial download anymore, so this never asks for a range again
+					return FetchFile(fileName, url, downloadFileLoc, priority, expectedSHA256, onProgress, sizeHint);
+				}
+
+				if (!response.Success()) {
+					getLogger().error("Curl Failed to download \"%s\" from Url \"%s\"! Error: (%i) %s", fileName.c_str(), url.c_str(), response.result, curl_easy_strerror(response.result));
+
+					// Keep what we have so the next attempt can carry on from here, unless theres no way to check the file wont have changed by then
+					// A 416 means the range we asked for doesnt exist anymore, so theres nothing worth keeping
+					if (state.offset > 0 && !state.GetValidator().empty() && response.httpCode != 416 && fdatasync(fd) == 0 && WritePartialDownload(statePath, state)) {
+						close(fd);
+					} else {
+						close(fd);
+						unlink(partPath.c_str());
+						unlink(statePath.c_str());
+					}
+
+					return {};
+				}
+
+				// An empty body never gets to onResponse, but it still means the file is empty now
+				if (!receivedResponse && response.httpCode != 206) {
+					success = ftruncate(fd, 0) == 0;
+					hash.Reset();
+				}
+
+				const TransferStats& stats = response.stats;
+				getLogger().info("Downloaded %llu bytes of \"%s\" from %s in %.2fs (connect %.3fs, TLS %.3fs, first byte %.3fs)", (unsigned long long)stats.bytesReceived, fileName.c_str(), stats.host.c_str(), stats.totalTime, stats.connectTime, stats.tlsTime, stats.timeToFirstByte);
+			}
+
+			DownloadResult result{success, hash.size, hash.crc32, hash.sha256.HexDigest()};
+
+			if (success && !expectedSHA256.empty() && !DigestMatches(expectedSHA256, result.sha256)) {
+				getLogger().error("Downloaded \"%s\" has the SHA-256 %s, but it should have been %s", fileName.c_str(), result.sha256.c_str(), expectedSHA256.c_str());
+
+				close(fd);
+				unlink(partPath.c_str());
+				unlink(statePath.c_str());
+
+				return {};
+			}
+
+			success = fsync(fd) == 0 && success;
+			success = close(fd) == 0 && success;
+
+			if (success) success = rename(partPath.c_str(), downloadFileLoc.c_str()) == 0;
+			unlink(statePath.c_str());
+
+			if (!success) {
+				getLogger().error("Failed to save \"%s\" to \"%s\"", fileName.c_str(), downloadFileLoc.c_str());
+				unlink(partPath.c_str());
+
+				return {};
+			}
+
+			HashUtils::CacheFileCRC32(downloadFileLoc, result.crc32);
+			HttpCache::StoreFile(url, state.etag, state.lastModified, downloadFileLoc, result.sha256, result.crc32);
+
+			return result;
+		}
+
+		struct InFlightDownload {
+			std::string destination;
+			std::shared_future<DownloadResult> result;
+
+			// Where other callers want the file. Only touched while holding InFlightDownloadsLock, until result is ready
+			std::vector<std::string> copyDestinations;
+			std::unordered_set<std::string> failedCopies;
+		};
+
+		inline std::mutex InFlightDownloadsLock;
+		inline std::unordered_map<std::string, std::shared_ptr<InFlightDownload>> InFlightDownloads;
+
+		/**
+		 * @brief Downloads a file, writing it to disk as it arrives
+		 * @details The transfer runs on the DownloadEngine thread, so it reuses any open connection to the host. This blocks until the download has finished.
+		 * While downloading, the file is kept at "<downloadFileLoc>.part", with its progress saved to "<downloadFileLoc>.part.json".
+		 * If the download is interrupted, the next download of the same url to the same place carries on from where it stopped, as long as the file on the server hasnt changed.
+		 * Files bigger than SegmentedDownloadThreshold are split into DownloadSegmentCount pieces which download at once over separate connections, if the server supports range requests.
+		 * As that needs an extra request to check, it's only tried when sizeHint or an old cached copy says the file is big enough. Interrupted segmented downloads carry on from where each piece stopped.
+		 * Downloaded files are kept in the HttpCache, and are only downloaded again if the server says they have changed.
+		 * If the url is already being downloaded, this waits for that download instead of starting another one, and the file is copied to downloadFileLoc once it is done.
+		 * The file's CRC32 and SHA-256 are worked out as it is written, so checking them never needs another read of the file.
+		 * Timings for every request are added to DownloadEngine::GetHostStats, so slow hosts can be told apart from slow storage
+		 *
+		 * @param fileName The name of the file, used for logging
+		 * @param url The url to download from
+		 * @param downloadFileLoc Where to save the file
+		 * @param priority Where the download goes in the engine's queue
+		 * @param expectedSHA256 The SHA-256 the file should have, in hex. If it doesnt match, the file is deleted and the download fails. Leave empty to skip the check
+		 * @param onProgress Called on the DownloadEngine thread as the file downloads. Not called if the file comes from the cache, or someone else is already downloading it
+		 * @param sizeHint Roughly how big the file is expected to be, if known. Only used to decide whether its worth downloading in segments, so 0 is always safe
+		 * @return The result of the download, which is true if the file was downloaded
+		 */
+		inline DownloadResult DownloadFile(std::string fileName, std::string url, std::string downloadFileLoc, RequestPriority priority = RequestPriority::Normal, std::string expectedSHA256 = "", std::function<void(const TransferProgress&)> onProgress = nullptr, uint64_t sizeHint = 0) {
+			std::promise<DownloadResult> promise;
+			std::shared_ptr<InFlightDownload> download;
+			bool alreadyDownloading = false;
+
+			{
+				std::unique_lock guard(InFlightDownloadsLock);
+
+				auto search = InFlightDownloads.find(url);
+				alreadyDownloading = search != InFlightDownloads.end();
+
+				if (alreadyDownloading) {
+					download = search->second;
+					if (download->destination != downloadFileLoc) download->copyDestinations.push_back(downloadFileLoc);
+				} else {
+					download = std::make_shared<InFlightDownload>();
+					download->destination = downloadFileLoc;
+					download->result = promise.get_future().share();
+
+					InFlightDownloads.emplace(url, download);
+				}
+			}
+
+			if (alreadyDownloading) {
+				getLogger().info("\"%s\" is already being downloaded, waiting for it to finish...", fileName.c_str());
+
+				// The failed copies are all filled in before the result is ready
+				DownloadResult result = download->result.get();
+				if (download->failedCopies.contains(downloadFileLoc)) return {};
+
+				// Whoever started the download might not have been expecting the same file
+				if (result && !expectedSHA256.empty() && !DigestMatches(expectedSHA256, result.sha256)) {
+					getLogger().error("Downloaded \"%s\" has the SHA-256 %s, but it should have been %s", fileName.c_str(), result.sha256.c_str(), expectedSHA256.c_str());
+					if (downloadFileLoc != download->destination) unlink(downloadFileLoc.c_str());
+
+					return {};
+				}
+
+				return result;
+			}
+
+			DownloadResult result = FetchFile(fileName, url, downloadFileLoc, priority, expectedSHA256, onProgress, sizeHint);
+
+			{
+				std::unique_lock guard(InFlightDownloadsLock);
+				InFlightDownloads.erase(url);
+
+				// Copy the file for everyone else who wanted it now, before our caller gets a chance to move or delete it
+				for (std::string& destination : download->copyDestinations) {
+					if (!result || !FileUtils::LinkOrCopy(downloadFileLoc, destination)) download->failedCopies.insert(destination);
+				}
+			}
+
+			promise.set_value(result);
+			return result;
+		}
+
+		/**
+		 * @brief Gets the body of a url
+		 * @details Responses are kept in the HttpCache, and a cached response is used if the server says it hasnt changed
+		 *
+		 * @param url The url to get
+		 * @param priority Where the request goes in the engine's queue
+		 * @return The body of the response, even if it was an error page. Empty if the request failed
+		 */
+		inline std::string GetData(std::string url, RequestPriority priority = RequestPriority::Normal) {
+			getLogger().info("Getting data from \"%s\"", url.c_str());
+
+			std::optional<HttpCache::CacheEntry> cached = HttpCache::Lookup(url);
+
+			if (HttpCache::OfflineMode) {
+				std::optional<std::string> body = cached.has_value() ? HttpCache::ReadBody(*cached) : std::nullopt;
+				if (!body.has_value()) getLogger().error("Cannot get data from \"%s\" in offline mode, as it isnt cached", url.c_str());
+
+				return body.value_or("");
+			}
+
+			std::string val;
+
+			WebRequest request;
+			request.url = url;
+			request.priority = priority;
+			request.failOnError = false;
+
+			if (cached.has_value()) request.headers = HttpCache::GetRevalidationHeaders(*cached);
+
+			request.onData = [&val](const char* data, size_t size) {
+				return WriteData((void*)data, 1, size, &val) == size;
+			};
+
+			WebResponse response = DownloadEngine::Get().SubmitAsync(std::move(request)).get();
+
+			if (!response.Success()) {
+				getLogger().error("Curl Failed to Get from Url \"%s\"! Error: (%i) %s", url.c_str(), response.result, curl_easy_strerror(response.result));
 				return "";
 			}
 
+			if (response.httpCode == 304 && cached.has_value()) {
+				std::optional<std::string> body = HttpCache::ReadBody(*cached);
+
+				if (body.has_value()) {
+					HttpCache::Touch(*cached);
+					return *body;
+				}
+
+				// The cached copy disappeared since we looked it up, so get it again without it
+				HttpCache::Remove(url);
+				return GetData(url, priority);
+			}
+
+			if (response.httpCode == 200) HttpCache::Store(url, response.GetHeader("etag"), response.GetHeader("last-modified"), val);
 			return val;
 		}
 
-		inline rapidjson::Document GetJSONData(std::string url) {
-			std::string data = GetData(url);
+		inline rapidjson::Document GetJSONData(std::string url, RequestPriority priority = RequestPriority::Normal) {
+			std::string data = GetData(url, priority);
 
 			rapidjson::Document document;
 			document.Parse(data);
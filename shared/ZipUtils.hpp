@@ -0,0 +1,404 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+#include "modloader-utils/shared/FileUtils.hpp"
+#include "modloader-utils/shared/HashUtils.hpp"
+
+namespace ModloaderUtils {
+	namespace ZipUtils {
+		// Zip record signatures (https://pkware.cachefly.net/webdocs/casestudies/APPNOTE.TXT)
+		inline constexpr uint32_t LocalFileHeaderSignature = 0x04034b50;
+		inline constexpr uint32_t CentralDirectorySignature = 0x02014b50;
+		inline constexpr uint32_t EndOfCentralDirectorySignature = 0x06054b50;
+		inline constexpr uint32_t Zip64EndOfCentralDirectorySignature = 0x06064b50;
+		inline constexpr uint32_t Zip64EndOfCentralDirectoryLocatorSignature = 0x07064b50;
+
+		inline constexpr uint16_t CompressionStored = 0;
+		inline constexpr uint16_t CompressionDeflate = 8;
+
+		/**
+		 * @brief A single file stored in a zip archive, as described by the central directory
+		 */
+		struct ZipEntry {
+			std::string name;
+			uint16_t compressionMethod;
+			uint32_t crc32;
+			uint64_t compressedSize;
+			uint64_t uncompressedSize;
+			uint64_t localHeaderOffset;
+		};
+
+		inline uint16_t ReadU16(const uint8_t* data) {
+			return (uint16_t)(data[0] | (data[1] << 8));
+		}
+
+		inline uint32_t ReadU32(const uint8_t* data) {
+			return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+		}
+
+		inline uint64_t ReadU64(const uint8_t* data) {
+			return (uint64_t)ReadU32(data) | ((uint64_t)ReadU32(data + 4) << 32);
+		}
+
+		/**
+		 * @brief A read-only, memory mapped zip archive
+		 * @details The archive is mapped once and its central directory is parsed up front, so looking up and inflating entries never spawns a process or touches a temp dir.
+		 * Reading entries is thread safe, as every read only touches the shared read-only mapping
+		 */
+		class ZipArchive {
+		public:
+			ZipArchive(std::string path) : m_Path(path) {
+				int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd < 0) return;
+
+				struct stat fileStat;
+				if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+					void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+					if (data != MAP_FAILED) {
+						m_Data = (const uint8_t*)data;
+						m_Size = fileStat.st_size;
+					}
+				}
+
+				// The mapping keeps the file alive, so we dont need the descriptor anymore
+				close(fd);
+
+				if (m_Data != nullptr) m_Valid = ParseCentralDirectory();
+			}
+
+			~ZipArchive() {
+				if (m_Data != nullptr) munmap((void*)m_Data, m_Size);
+			}
+
+			ZipArchive(const ZipArchive&) = delete;
+			ZipArchive& operator=(const ZipArchive&) = delete;
+
+			const inline bool Valid() const { return m_Valid; }
+			const inline std::string& Path() const { return m_Path; }
+			const inline std::vector<ZipEntry>& Entries() const { return m_Entries; }
+
+			/**
+			 * @brief Gets a hash that identifies the contents of the archive
+			 * @details This is the CRC32 of the central directory, which holds the CRC32 of every entry, so it changes whenever any file in the archive does without having to read the whole archive
+			 *
+			 * @return The archive's hash, or 0 if the archive is invalid
+			 */
+			const inline uint32_t Fingerprint() const { return m_Fingerprint; }
+
+			/**
+			 * @brief Finds an entry in the central directory
+			 *
+			 * @param name The full path of the entry inside the archive
+			 * @return The entry, or nullptr if the archive doesn't contain it
+			 */
+			const ZipEntry* FindEntry(std::string name) const {
+				auto search = m_EntryIndices.find(name);
+				if (search == m_EntryIndices.end()) return nullptr;
+
+				return &m_Entries[search->second];
+			}
+
+			/**
+			 * @brief Inflates an entry, passing the uncompressed data to a sink in chunks
+			 * @details The sink is called as `bool sink(const uint8_t* data, size_t size)` and can return false to abort.
+			 * The CRC32 of the inflated data is checked against the central directory
+			 *
+			 * @param entry The entry to inflate
+			 * @param sink The function that receives each chunk of uncompressed data
+			 * @return Returns true if the whole entry was inflated and its CRC32 matched
+			 */
+			template<typename Sink>
+			bool InflateEntry(const ZipEntry& entry, Sink&& sink) const {
+				const uint8_t* compressedData = GetEntryData(entry);
+				if (compressedData == nullptr) return false;
+
+				uint32_t crc = 0;
+				uint64_t written = 0;
+
+				if (entry.compressionMethod == CompressionStored) {
+					if (entry.compressedSize != entry.uncompressedSize) return false;
+
+					// Feed stored data through in chunks so sinks see the same sizes as with deflated data
+					for (uint64_t offset = 0; offset < entry.uncompressedSize; offset += ChunkSize) {
+						size_t chunkSize = (size_t)std::min<uint64_t>(ChunkSize, entry.uncompressedSize - offset);
+
+						crc = HashUtils::CRC32(crc, compressedData + offset, chunkSize);
+						if (!sink(compressedData + offset, chunkSize)) return false;
+					}
+
+					written = entry.uncompressedSize;
+				} else if (entry.compressionMethod == CompressionDeflate) {
+					z_stream stream;
+					memset(&stream, 0, sizeof(stream));
+
+					// Negative window bits means raw deflate data, which is what zip stores
+					if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) return false;
+
+					uint8_t buffer[ChunkSize];
+					uint64_t remainingInput = entry.compressedSize;
+					const uint8_t* input = compressedData;
+					int result = Z_OK;
+
+					while (result != Z_STREAM_END) {
+						if (stream.avail_in == 0 && remainingInput > 0) {
+							uInt inputSize = (uInt)std::min<uint64_t>(remainingInput, UINT32_MAX);
+
+							stream.next_in = (Bytef*)input;
+							stream.avail_in = inputSize;
+
+							input += inputSize;
+							remainingInput -= inputSize;
+						}
+
+						stream.next_out = buffer;
+						stream.avail_out = sizeof(buffer);
+
+						result = inflate(&stream, Z_NO_FLUSH);
+						if (result != Z_OK && result != Z_STREAM_END) break;
+
+						size_t produced = sizeof(buffer) - stream.avail_out;
+						if (produced > 0) {
+							crc = HashUtils::CRC32(crc, buffer, produced);
+							written += produced;
+
+							if (!sink(buffer, produced)) {
+								result = Z_DATA_ERROR;
+								break;
+							}
+						} else if (stream.avail_in == 0 && remainingInput == 0) {
+							// No more input and no more output, the data is truncated
+							result = Z_DATA_ERROR;
+							break;
+						}
+					}
+
+					inflateEnd(&stream);
+					if (result != Z_STREAM_END) return false;
+				} else {
+					// Qmods are only ever stored or deflated, anything else isn't worth supporting
+					return false;
+				}
+
+				return written == entry.uncompressedSize && crc == entry.crc32;
+			}
+
+			/**
+			 * @brief Inflates an entry into memory
+			 *
+			 * @param name The full path of the entry inside the archive
+			 * @return The uncompressed contents of the entry, or nullopt if it couldnt be found or read
+			 */
+			std::optional<std::string> ReadEntry(std::string name) const {
+				const ZipEntry* entry = FindEntry(name);
+				if (entry == nullptr) return std::nullopt;
+
+				std::string contents;
+				contents.reserve((size_t)std::min<uint64_t>(entry->uncompressedSize, 16 * 1024 * 1024));
+
+				bool success = InflateEntry(*entry, [&](const uint8_t* data, size_t size) {
+					contents.append((const char*)data, size);
+					return true;
+				});
+
+				if (!success) return std::nullopt;
+				return contents;
+			}
+
+			/**
+			 * @brief Calculates the SHA-256 of an entry's uncompressed contents, without writing it anywhere
+			 *
+			 * @param entry The entry to hash
+			 * @return The SHA-256 as lower case hex, or nullopt if the entry couldnt be read
+			 */
+			std::optional<std::string> HashEntry(const ZipEntry& entry) const {
+				HashUtils::SHA256 sha256;
+
+				bool success = InflateEntry(entry, [&](const uint8_t* data, size_t size) {
+					sha256.Update(data, size);
+					return true;
+				});
+
+				if (!success) return std::nullopt;
+				return sha256.HexDigest();
+			}
+
+			/**
+			 * @brief Inflates an entry straight to its destination file
+			 * @details The entry is written to a temp file next to the destination, fsynced and then renamed into place,
+			 * so the destination is never left half written and no staging copy is needed
+			 *
+			 * @param entry The entry to extract
+			 * @param destination The path to write the entry to. Any existing file is replaced
+			 * @return Returns true if the entry was fully extracted
+			 */
+			bool ExtractEntry(const ZipEntry& entry, std::string destination) const {
+				FileUtils::AtomicFile file(destination);
+				if (!file.Valid()) return false;
+
+				bool success = InflateEntry(entry, [&](const uint8_t* data, size_t size) {
+					return file.Write(data, size);
+				});
+
+				return success && file.Commit();
+			}
+
+		private:
+			inline static constexpr size_t ChunkSize = 64 * 1024;
+
+			bool ParseCentralDirectory() {
+				// The End Of Central Directory record is at least 22 bytes, and can be followed by a comment of up to 65535 bytes
+				if (m_Size < 22) return false;
+
+				const uint8_t* eocd = nullptr;
+				size_t searchStart = m_Size - 22;
+				size_t searchEnd = m_Size > 22 + 0xFFFF ? m_Size - 22 - 0xFFFF : 0;
+
+				for (size_t i = searchStart + 1; i-- > searchEnd;) {
+					if (ReadU32(m_Data + i) == EndOfCentralDirectorySignature) {
+						eocd = m_Data + i;
+						break;
+					}
+				}
+
+				if (eocd == nullptr) return false;
+
+				uint64_t entryCount = ReadU16(eocd + 10);
+				uint64_t directorySize = ReadU32(eocd + 12);
+				uint64_t directoryOffset = ReadU32(eocd + 16);
+
+				// Zip64 archives store the real values in a seperate record, pointed to by a locator right before the EOCD
+				if (entryCount == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF) {
+					size_t eocdOffset = eocd - m_Data;
+					if (eocdOffset < 20) return false;
+
+					const uint8_t* locator = eocd - 20;
+					if (ReadU32(locator) != Zip64EndOfCentralDirectoryLocatorSignature) return false;
+
+					uint64_t zip64EocdOffset = ReadU64(locator + 8);
+					if (m_Size < 56 || zip64EocdOffset > m_Size - 56) return false;
+
+					const uint8_t* zip64Eocd = m_Data + zip64EocdOffset;
+					if (ReadU32(zip64Eocd) != Zip64EndOfCentralDirectorySignature) return false;
+
+					entryCount = ReadU64(zip64Eocd + 32);
+					directorySize = ReadU64(zip64Eocd + 40);
+					directoryOffset = ReadU64(zip64Eocd + 48);
+				}
+
+				if (directoryOffset > m_Size || directorySize > m_Size - directoryOffset) return false;
+
+				const uint8_t* record = m_Data + directoryOffset;
+				const uint8_t* directoryEnd = record + directorySize;
+
+				m_Fingerprint = HashUtils::CRC32(0, record, directorySize);
+				// The count comes straight from the file, so dont trust it any further than the number of records that could fit in the directory
+				m_Entries.reserve(std::min<uint64_t>(entryCount, directorySize / 46));
+
+				for (uint64_t i = 0; i < entryCount; i++) {
+					if (directoryEnd - record < 46 || ReadU32(record) != CentralDirectorySignature) return false;
+
+					uint16_t nameLength = ReadU16(record + 28);
+					uint16_t extraLength = ReadU16(record + 30);
+					uint16_t commentLength = ReadU16(record + 32);
+
+					if ((size_t)(directoryEnd - record) < 46 + (size_t)nameLength + extraLength + commentLength) return false;
+
+					ZipEntry entry;
+					entry.name = std::string((const char*)record + 46, nameLength);
+					entry.compressionMethod = ReadU16(record + 10);
+					entry.crc32 = ReadU32(record + 16);
+					entry.compressedSize = ReadU32(record + 20);
+					entry.uncompressedSize = ReadU32(record + 24);
+					entry.localHeaderOffset = ReadU32(record + 42);
+
+					ReadZip64ExtraField(entry, record + 46 + nameLength, extraLength);
+
+					// Directories dont have any data, so theres no point keeping them around
+					if (!entry.name.empty() && entry.name.back() != '/') {
+						m_EntryIndices.emplace(entry.name, m_Entries.size());
+						m_Entries.push_back(std::move(entry));
+					}
+
+					record += 46 + nameLength + extraLength + commentLength;
+				}
+
+				return true;
+			}
+
+			static void ReadZip64ExtraField(ZipEntry& entry, const uint8_t* extra, uint16_t extraLength) {
+				const uint8_t* extraEnd = extra + extraLength;
+
+				while (extraEnd - extra >= 4) {
+					uint16_t headerId = ReadU16(extra);
+					uint16_t dataSize = ReadU16(extra + 2);
+					const uint8_t* data = extra + 4;
+
+					if (extraEnd - data < dataSize) return;
+
+					if (headerId == 0x0001) {
+						// Only the fields that overflowed are present, in this order
+						const uint8_t* dataEnd = data + dataSize;
+
+						if (entry.uncompressedSize == 0xFFFFFFFF && dataEnd - data >= 8) {
+							entry.uncompressedSize = ReadU64(data);
+							data += 8;
+						}
+
+						if (entry.compressedSize == 0xFFFFFFFF && dataEnd - data >= 8) {
+							entry.compressedSize = ReadU64(data);
+							data += 8;
+						}
+
+						if (entry.localHeaderOffset == 0xFFFFFFFF && dataEnd - data >= 8) {
+							entry.localHeaderOffset = ReadU64(data);
+						}
+
+						return;
+					}
+
+					extra = data + dataSize;
+				}
+			}
+
+			const uint8_t* GetEntryData(const ZipEntry& entry) const {
+				if (entry.localHeaderOffset > m_Size || m_Size - entry.localHeaderOffset < 30) return nullptr;
+
+				const uint8_t* header = m_Data + entry.localHeaderOffset;
+				if (ReadU32(header) != LocalFileHeaderSignature) return nullptr;
+
+				// The local header can have a different extra field to the central directory, so we have to read its own lengths
+				uint64_t dataOffset = entry.localHeaderOffset + 30 + ReadU16(header + 26) + ReadU16(header + 28);
+				if (dataOffset > m_Size || m_Size - dataOffset < entry.compressedSize) return nullptr;
+
+				return m_Data + dataOffset;
+			}
+
+			std::string m_Path;
+
+			const uint8_t* m_Data = nullptr;
+			size_t m_Size = 0;
+
+			std::vector<ZipEntry> m_Entries;
+			std::unordered_map<std::string, size_t> m_EntryIndices;
+
+			uint32_t m_Fingerprint = 0;
+
+			bool m_Valid = false;
+		};
+	}
+}